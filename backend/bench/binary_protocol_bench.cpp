@@ -0,0 +1,132 @@
+// Cost of one round of market data and one trade request, binary protocol
+// against the text protocol over HTTP:
+//   quotes: the server encodes every quote and the client decodes the
+//     prices (QUOTES frame vs a GET_MARKET body split and strtod'ed). The
+//     server renders the text body once per generation, so for it the
+//     decode is the cost every request pays.
+//   request: the server gets from received bytes to the BUY arguments
+//     (frame header + TradeBody vs HttpParser + splitting the command)
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 bench/binary_protocol_bench.cpp utils/http_parser.cpp -o binary_protocol_bench
+//   ./binary_protocol_bench [quotes] [iterations]
+
+#include "../utils/binary_protocol.h"
+#include "../utils/http_parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace binary_protocol;
+
+struct BenchQuote {
+    std::string ticker;
+    std::string name;
+    std::string price_text;
+    double price;
+};
+
+// What the client ends up with
+double sink = 0;
+
+std::string encodeText(const std::vector<BenchQuote>& quotes) {
+    std::string out = "DATA|";
+    for (const auto& quote : quotes) out += quote.ticker + "," + quote.name + "," + quote.price_text + ";";
+    return out;
+}
+
+void decodeText(const std::string& body) {
+    size_t at = 5;  // after "DATA|"
+    while (at < body.size()) {
+        size_t end = body.find(';', at);
+        size_t price = body.rfind(',', end) + 1;
+        sink += std::strtod(body.c_str() + price, nullptr);
+        at = end + 1;
+    }
+}
+
+std::string encodeBinary(const std::vector<BenchQuote>& quotes) {
+    std::string out;
+    char* at = appendFrame(out, QUOTES, OK, 1, 8 + quotes.size() * sizeof(QuoteEntry));
+    store<uint32_t>(at, static_cast<uint32_t>(quotes.size()));
+    store<uint32_t>(at + 4, 0);
+    at += 8;
+    for (uint32_t i = 0; i < quotes.size(); ++i) {
+        store(at, QuoteEntry{i, 0, quotes[i].price});
+        at += sizeof(QuoteEntry);
+    }
+    return out;
+}
+
+void decodeBinary(const std::string& frame) {
+    const char* body = frame.data() + HEADER_SIZE;
+    uint32_t count = load<uint32_t>(body);
+    for (uint32_t i = 0; i < count; ++i) sink += load<QuoteEntry>(body + 8 + i * sizeof(QuoteEntry)).price;
+}
+
+template <typename F>
+double nsPerCall(size_t iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) f();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500;
+    size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000;
+
+    std::vector<BenchQuote> quotes;
+    for (size_t i = 0; i < count; ++i) {
+        double price = 10 + (i * 7919 % 50000) / 100.0;
+        quotes.push_back({"T" + std::to_string(i), "Company " + std::to_string(i) + " Inc.", std::to_string(price),
+                          price});
+    }
+
+    const std::string text = encodeText(quotes);
+    const std::string binary = encodeBinary(quotes);
+    double text_encode = nsPerCall(iterations, [&] { sink += encodeText(quotes).size(); });
+    double text_decode = nsPerCall(iterations, [&] { decodeText(text); });
+    double binary_encode = nsPerCall(iterations, [&] { sink += encodeBinary(quotes).size(); });
+    double binary_decode = nsPerCall(iterations, [&] { decodeBinary(binary); });
+
+    const std::string command = "BUY|ellaharding@x.ca|AAPL|10";
+    const std::string http = "POST / HTTP/1.1\r\nHost: localhost:8081\r\nContent-Type: text/plain\r\n"
+                             "Cookie: sessionId=5f2c9e0a81b34d7c\r\nContent-Length: " +
+                             std::to_string(command.size()) + "\r\n\r\n" + command;
+    std::string frame;
+    store(appendFrame(frame, BUY, OK, 7, sizeof(TradeBody)), TradeBody{3, 10});
+
+    HttpParser parser;
+    size_t request_iterations = iterations * 50;
+    double text_request = nsPerCall(request_iterations, [&] {
+        parser.reset();
+        if (parser.parse(http) != HttpParser::Status::Complete) std::abort();
+        std::string_view args = parser.request().body().substr(4);
+        size_t user_end = args.find('|');
+        size_t ticker_end = args.find('|', user_end + 1);
+        sink += user_end + ticker_end + std::strtol(args.data() + ticker_end + 1, nullptr, 10);
+    });
+    double binary_request = nsPerCall(request_iterations, [&] {
+        if (frame.size() < HEADER_SIZE || frameLength(frame.data()) != frame.size()) std::abort();
+        TradeBody order = load<TradeBody>(frame.data() + HEADER_SIZE);
+        sink += frameType(frame.data()) + order.ticker + order.quantity;
+    });
+
+    std::cout << std::fixed << std::setprecision(1)
+              << count << " quotes, encode / decode:\n"
+              << "  text GET_MARKET   " << text_encode << " / " << text_decode << " ns, " << text.size() << " bytes\n"
+              << "  binary QUOTES     " << binary_encode << " / " << binary_decode << " ns, " << binary.size()
+              << " bytes\n"
+              << "BUY request, bytes to arguments:\n"
+              << "  HTTP + text       " << text_request << " ns, " << http.size() << " bytes\n"
+              << "  binary frame      " << binary_request << " ns, " << frame.size() << " bytes\n"
+              << "(" << static_cast<long>(sink) % 10 << ")\n";
+}
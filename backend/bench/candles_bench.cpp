@@ -0,0 +1,112 @@
+// Tick log and candle queries: writes a random walk of prices for a few
+// hundred tickers into a TickStore (a block per simulated second),
+// reports its size per tick and how fast it decodes, then compares a
+// CANDLES-style query answered from the CandleStore buckets against
+// aggregating the same candles by scanning the raw ticks.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 -pthread bench/candles_bench.cpp utils/market_history.cpp utils/tick_store.cpp utils/dictionary.cpp utils/quote_table.cpp utils/transaction_index.cpp utils/trade_store.cpp utils/csv.cpp utils/snapshot.cpp utils/metrics.cpp utils/logger.cpp -o candles_bench
+//   ./candles_bench [ticks]
+
+#include "../utils/market_history.h"
+#include "../utils/tick_store.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    const size_t tickers = 500;
+    const size_t per_second = 2000;  // ticks in one block
+    const int64_t start_ms = 1700000000000;
+
+    std::string directory = "/tmp/candles_bench_" + std::to_string(getpid());
+    std::vector<std::string> names;
+    std::vector<double> prices(tickers);
+    std::mt19937 random(7);
+    for (size_t i = 0; i < tickers; ++i) {
+        names.push_back("T" + std::to_string(i));
+        prices[i] = 20 + random() % 500;
+    }
+
+    size_t bytes;
+    {
+        TickStore store(directory);
+        store.open();
+        auto start = Clock::now();
+        for (size_t n = 0; n < count; ++n) {
+            size_t i = random() % tickers;
+            prices[i] = std::max(0.01, prices[i] + (static_cast<int>(random() % 21) - 10) * 0.01);
+            int64_t time = start_ms + static_cast<int64_t>(n * 1000 / per_second);
+            store.append(names[i], time, prices[i]);
+            if ((n + 1) % per_second == 0) store.flush();
+        }
+        store.flush();
+        bytes = store.bytes();
+        double seconds = secondsSince(start);
+        std::printf("write   %zu ticks in %.3f s (%.2f M ticks/s), %zu bytes, %.2f bytes/tick\n", count, seconds,
+                    count / seconds / 1e6, bytes, double(bytes) / count);
+    }
+
+    TickStore store(directory);
+    store.open();
+    CandleStore candles;
+    auto start = Clock::now();
+    size_t decoded = 0;
+    store.forEach(0, [&](const std::string& ticker, int64_t time_ms, double price) {
+        candles.onTick(ticker, time_ms, price);
+        ++decoded;
+    });
+    double seconds = secondsSince(start);
+    std::printf("rebuild %zu ticks decoded into candles in %.3f s (%.2f M ticks/s)\n", decoded, seconds,
+                decoded / seconds / 1e6);
+
+    // One ticker's 1m candles over the whole span, both ways
+    const std::string wanted = names[0];
+    const int64_t end_ms = start_ms + static_cast<int64_t>(count * 1000 / per_second);
+    const int queries = 1000;
+    std::vector<Candle> result;
+    start = Clock::now();
+    for (int q = 0; q < queries; ++q) {
+        result.clear();
+        candles.candles(wanted, 60 * 1000, 0, end_ms, 100000, result);
+    }
+    double bucket_us = secondsSince(start) * 1e6 / queries;
+
+    start = Clock::now();
+    std::vector<Candle> scanned;
+    store.forEach(0, [&](const std::string& ticker, int64_t time_ms, double price) {
+        if (ticker != wanted) return;
+        int64_t bucket = time_ms - time_ms % 60000;
+        if (scanned.empty() || scanned.back().start_ms != bucket) {
+            scanned.push_back({bucket, price, price, price, price, 0});
+        }
+        Candle& c = scanned.back();
+        c.high = std::max(c.high, price);
+        c.low = std::min(c.low, price);
+        c.close = price;
+    });
+    double scan_us = secondsSince(start) * 1e6;
+
+    std::printf("query   %zu 1m candles: %.1f us from buckets, %.1f us scanning ticks (%s)\n", result.size(),
+                bucket_us, scan_us, result.size() == scanned.size() ? "same buckets" : "MISMATCH");
+
+    store.removeBefore(INT64_MAX);
+    unlink((directory + "/tickers.dict").c_str());
+    rmdir(directory.c_str());
+    return 0;
+}
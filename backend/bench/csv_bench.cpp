@@ -0,0 +1,98 @@
+// CSV parse cost: the stringstream/getline readCSV the server used before
+// against the mapped SIMD tokenizer, both as readCSV (copying every cell)
+// and through the visitor API. Reports time and heap allocations per pass
+// over a generated transactions.csv.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 -pthread bench/csv_bench.cpp utils/csv.cpp utils/snapshot.cpp utils/metrics.cpp -o csv_bench
+//   ./csv_bench [rows]           (CSV_SIMD=scalar|sse2 forces a kernel)
+
+#include "../utils/csv.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+std::vector<std::vector<std::string>> legacyReadCSV(const std::string& filename) {
+    std::ifstream file(filename);
+    std::vector<std::vector<std::string>> data;
+    std::string line;
+    while (getline(file, line)) {
+        std::stringstream ss(line);
+        std::string cell;
+        std::vector<std::string> row;
+        while (getline(ss, cell, ',')) {
+            row.push_back(cell);
+        }
+        data.push_back(row);
+    }
+    return data;
+}
+
+template <typename F>
+void measure(const char* name, size_t rows, F&& pass) {
+    const int PASSES = 5;
+    size_t checksum = pass();  // warm the page cache
+    size_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PASSES; ++i) checksum += pass();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocated = allocations.load() - before;
+
+    double seconds = elapsed.count() / PASSES;
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << seconds * 1000 << " ms  "
+              << std::setw(7) << rows / seconds / 1e6 << " M rows/s  "
+              << std::setw(12) << allocated / PASSES << " allocations"
+              << "  (" << checksum % 1000 << ")\n";
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::string path = "/tmp/csv_bench_" + std::to_string(::getpid()) + ".csv";
+    {
+        CsvWriter writer;
+        for (size_t i = 0; i < rows; ++i) {
+            writer.row("user" + std::to_string(i % 50000), i % 3 ? "BUY" : "SELL",
+                       i % 2 ? "AAPL" : "GOOGL", static_cast<int>(1 + i % 20));
+        }
+        writer.writeTo(path);
+    }
+
+    measure("legacy readCSV", rows, [&] { return legacyReadCSV(path).size(); });
+    measure("readCSV (copying)", rows, [&] { return readCSV(path).size(); });
+    measure("visitCSV", rows, [&] {
+        size_t total = 0;
+        visitCSV(path, [&total](const CsvRow& row) {
+            int quantity;
+            if (row.get(3, quantity)) total += quantity;
+        });
+        return total;
+    });
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Market feed ingestion: producer threads push random prices for a few
+// thousand tickers into a MarketFeed as fast as they can, while a probe
+// publishes one ticker's price and times how long until a QuoteTable
+// reader sees it. Reports throughput, how many updates each published
+// generation coalesced, and probe latency idle and under load.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 -pthread bench/feed_bench.cpp utils/market_feed.cpp utils/quote_table.cpp utils/csv.cpp utils/snapshot.cpp utils/metrics.cpp utils/logger.cpp -o feed_bench
+//   ./feed_bench [tickers] [producers]
+
+#include "../utils/market_feed.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Microseconds until each of `probes` prices is visible to a reader
+std::vector<double> probe(MarketFeed& feed, QuoteTable& table, int probes) {
+    std::vector<double> latencies;
+    for (int i = 1; i <= probes; ++i) {
+        double price = 1000 + i * 0.01;
+        auto start = Clock::now();
+        feed.publish("PROBE", price);
+        while (true) {
+            auto market = table.snapshot();
+            const Quote* quote = market->find("PROBE");
+            if (quote && quote->price == price) break;
+            std::this_thread::yield();  // leave the core to the ingester on small machines
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void report(const char* label, const std::vector<double>& latencies) {
+    std::printf("%-12s probe latency  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", label,
+                latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t tickers = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    int producers = argc > 2 ? std::atoi(argv[2]) : 4;
+
+    std::string filename = "/tmp/feed_bench_market_" + std::to_string(getpid()) + ".csv";
+    {
+        std::ofstream file(filename);
+        for (size_t i = 0; i < tickers; ++i) file << "T" << i << ",Company " << i << ",100.00\n";
+        file << "PROBE,Probe,1000.00\n";
+    }
+    QuoteTable table(filename);
+    std::atomic<size_t> generations{0};
+    table.addListener([&generations](const MarketSnapshot&, const MarketSnapshot&) { ++generations; });
+
+    MarketFeed feed(table);
+    feed.start();
+    report("idle", probe(feed, table, 1000));
+
+    std::atomic<bool> running{true};
+    std::atomic<size_t> published{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            std::mt19937 random(p);
+            std::vector<std::string> names;
+            for (size_t i = 0; i < tickers; ++i) names.push_back("T" + std::to_string(i));
+            size_t count = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                feed.publish(names[random() % tickers], 50 + (random() % 10000) * 0.01);
+                ++count;
+            }
+            published += count;
+        });
+    }
+
+    size_t before = generations;
+    auto start = Clock::now();
+    std::vector<double> loaded = probe(feed, table, 1000);
+    running = false;
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t published_generations = generations - before;
+
+    report("loaded", loaded);
+    std::printf("%d producers, %zu tickers: %.2f M updates/s queued, %zu generations published "
+                "(%.0f updates coalesced into each)\n",
+                producers, tickers, published / seconds / 1e6, published_generations,
+                published_generations ? double(published) / published_generations : 0.0);
+
+    feed.stop();
+    unlink(filename.c_str());
+    return 0;
+}
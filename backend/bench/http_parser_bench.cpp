@@ -0,0 +1,113 @@
+// Parse cost per request: HttpParser against the substr/find parsing the
+// server used before (parseHttpRequest + getSessionIdFromRequest).
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 bench/http_parser_bench.cpp utils/http_parser.cpp -o http_parser_bench
+
+#include "../utils/http_parser.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+const std::string REQUEST =
+    "POST / HTTP/1.1\r\n"
+    "Host: localhost:8081\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 27\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\"\r\n"
+    "Content-Type: text/plain\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36\r\n"
+    "Accept: */*\r\n"
+    "Origin: http://localhost:8080\r\n"
+    "Sec-Fetch-Site: same-site\r\n"
+    "Sec-Fetch-Mode: cors\r\n"
+    "Referer: http://localhost:8080/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: theme=dark; sessionId=session_testuser_1712345678\r\n"
+    "\r\n"
+    "PORTFOLIO|ellaharding@x.ca";
+
+std::string legacyParse(const std::string& request) {
+    if (request.substr(0, 3) == "GET") {
+        size_t start = request.find('/') + 1;
+        size_t end = request.find(' ', start);
+        if (start != std::string::npos && end != std::string::npos) {
+            return request.substr(start, end - start);
+        }
+    } else if (request.substr(0, 4) == "POST") {
+        size_t headerEnd = request.find("\r\n\r\n");
+        if (headerEnd != std::string::npos) {
+            return request.substr(headerEnd + 4);
+        }
+    }
+    return request;
+}
+
+std::string legacySessionId(const std::string& request) {
+    std::string cookieToken = "Cookie:";
+    size_t pos = request.find(cookieToken);
+    if (pos != std::string::npos) {
+        size_t end = request.find("\r\n", pos);
+        std::string cookieLine = request.substr(pos, end - pos);
+        size_t sPos = cookieLine.find("sessionId=");
+        if (sPos != std::string::npos) {
+            sPos += std::string("sessionId=").length();
+            size_t semicolon = cookieLine.find(";", sPos);
+            if (semicolon == std::string::npos)
+                return cookieLine.substr(sPos);
+            else
+                return cookieLine.substr(sPos, semicolon - sPos);
+        }
+    }
+    return "";
+}
+
+template <typename F>
+double nsPerOp(size_t iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 2000000;
+    size_t sink = 0;
+
+    double legacy = nsPerOp(iterations, [&] {
+        std::string request(REQUEST);  // the old path copied the read buffer into a string
+        sink += legacyParse(request).size() + legacySessionId(request).size();
+    });
+
+    HttpParser parser;
+    double whole = nsPerOp(iterations, [&] {
+        parser.reset();
+        parser.parse(REQUEST);
+        sink += parser.request().command().size() + parser.request().cookie("sessionId").size();
+    });
+
+    // Same request arriving in 64-byte reads
+    double split = nsPerOp(iterations, [&] {
+        parser.reset();
+        for (size_t n = 64; n < REQUEST.size(); n += 64) {
+            parser.parse(std::string_view(REQUEST.data(), n));
+        }
+        parser.parse(REQUEST);
+        sink += parser.request().command().size() + parser.request().cookie("sessionId").size();
+    });
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "request size           " << REQUEST.size() << " bytes\n"
+              << "legacy substr/find     " << legacy << " ns/request\n"
+              << "HttpParser             " << whole << " ns/request\n"
+              << "HttpParser, 64B reads  " << split << " ns/request\n"
+              << "(checksum " << sink << ")\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Order book matching throughput: a stream of limit orders scattered
+// around a mid price, a fifth of them followed later by a cancel, run
+// through one OrderBook on one thread as a matcher would. The operations
+// are generated up front so only the book is timed.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 bench/matching_bench.cpp utils/order_book.cpp -o matching_bench
+//   ./matching_bench [orders]
+
+#include "../utils/order_book.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Operation {
+    bool cancel;
+    OrderBook::Side side;
+    int64_t price;
+    int32_t quantity;
+    size_t target;  // for a cancel: index of the order it cancels
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t orders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    const int64_t mid = 10000;  // $100.00 in cents
+
+    std::mt19937_64 random(42);
+    std::vector<Operation> operations;
+    operations.reserve(orders + orders / 4);
+    std::vector<size_t> cancellable;
+    for (size_t i = 0; i < orders; ++i) {
+        OrderBook::Side side = random() % 2 ? OrderBook::BUY : OrderBook::SELL;
+        // Mostly passive with some crossing, so books build up and trade
+        int64_t offset = static_cast<int64_t>(random() % 60) - 10;
+        int64_t price = side == OrderBook::BUY ? mid - offset : mid + offset;
+        operations.push_back({false, side, price, static_cast<int32_t>(1 + random() % 100), 0});
+        if (random() % 5 == 0) cancellable.push_back(i);
+        if (!cancellable.empty() && random() % 4 == 0) {
+            size_t pick = random() % cancellable.size();
+            operations.push_back({true, OrderBook::BUY, 0, 0, cancellable[pick]});
+            cancellable[pick] = cancellable.back();
+            cancellable.pop_back();
+        }
+    }
+
+    OrderBook book;
+    std::vector<uint64_t> ids(orders, 0);
+    size_t placed = 0, fills = 0, cancelled = 0;
+    long long traded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Operation& op : operations) {
+        if (op.cancel) {
+            if (ids[op.target] != 0 && book.cancel(ids[op.target]) > 0) ++cancelled;
+            continue;
+        }
+        auto result = book.add(static_cast<uint32_t>(placed % 1000), op.side, op.price, op.quantity,
+                               [&](const Fill& fill) {
+                                   ++fills;
+                                   traded += fill.quantity;
+                               });
+        ids[placed++] = result.id;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%zu orders, %zu cancels applied, %zu fills (%lld shares), %zu resting\n", placed, cancelled, fills,
+                traded, book.openOrders());
+    std::printf("%.3f s, %.2f M operations/s\n", seconds, operations.size() / seconds / 1e6);
+    return 0;
+}
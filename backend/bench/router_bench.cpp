@@ -0,0 +1,100 @@
+// Dispatch cost per command: CommandRouter (compile-time hashed command
+// table, CommandArgs over string_views) against the rfind chain with
+// istringstream/substr/stoi tokenizing the server used before. Handlers
+// only parse their arguments, so the numbers are routing plus parsing.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 bench/router_bench.cpp utils/command_router.cpp utils/http_parser.cpp utils/metrics.cpp -o router_bench
+//   ./router_bench [iterations]
+
+#include "../utils/command_router.h"
+#include "../utils/http_parser.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> LINES = {
+    "GET_MARKET",
+    "PORTFOLIO|ellaharding@x.ca",
+    "BUY|ellaharding@x.ca|AAPL|10",
+    "SELL|ellaharding@x.ca|MSFT|3",
+    "CSV_BUYS|ellaharding@x.ca",
+    "HISTORY|ellaharding@x.ca|ALL|0|20|1712000000000|1713000000000",
+    "LIMIT|ellaharding@x.ca|BUY|TSLA|5|239.43",
+    "METRICS",
+};
+
+// What the handlers do with their arguments
+size_t sink = 0;
+
+void registerAll(CommandRouter& router) {
+    for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+        Command command = static_cast<Command>(i);
+        bool bare = command == Command::GET_MARKET || command == Command::STREAM_MARKET ||
+                    command == Command::METRICS;
+        router.add(command, bare ? CommandRouter::NO_ARGUMENTS : CommandRouter::WITH_ARGUMENTS, false,
+                   [](CommandArgs& args, CommandContext&) {
+            std::string_view field;
+            while (args.next(field)) sink += field.size();
+            return std::string("OK|");
+        });
+    }
+}
+
+// The shape of the old dispatch: test prefixes in turn, then copy and
+// tokenize the arguments
+std::string legacyDispatch(const std::string& command) {
+    static const char* prefixes[] = {"LOGIN|", "REGISTER|", "BUY|", "SELL|", "PORTFOLIO|", "CSV_BUYS|",
+                                     "RECENT_SELLS|", "HISTORY|", "PNL|", "VOLUME|", "CANDLES|", "LIMIT|",
+                                     "CANCEL|", "MODIFY|"};
+    if (command == "GET_MARKET" || command == "STREAM_MARKET" || command == "METRICS") return "OK|";
+    for (const char* prefix : prefixes) {
+        if (command.rfind(prefix, 0) != 0) continue;
+        std::istringstream iss(command.substr(std::char_traits<char>::length(prefix)));
+        std::string part;
+        while (std::getline(iss, part, '|')) sink += part.size();
+        if (command.rfind("BUY|", 0) == 0) sink += std::stoi(command.substr(command.rfind('|') + 1));
+        return "OK|";
+    }
+    return "ERROR|Unknown command";
+}
+
+template <typename F>
+double nsPerCall(size_t iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) f(LINES[i % LINES.size()]);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    CommandRouter router;
+    registerAll(router);
+    HttpRequest request;
+
+    double routed = nsPerCall(iterations, [&](const std::string& line) {
+        CommandContext context{request, ""};
+        bool success;
+        sink += router.run(line, context, success).size();
+    });
+    double legacy = nsPerCall(iterations, [](const std::string& line) { sink += legacyDispatch(line).size(); });
+    double lookup = nsPerCall(iterations, [](const std::string& line) {
+        sink += static_cast<size_t>(lookupCommand(std::string_view(line).substr(0, line.find('|'))));
+    });
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "router dispatch   " << routed << " ns/command (including the duration histogram)\n"
+              << "legacy if/else    " << legacy << " ns/command\n"
+              << "name lookup only  " << lookup << " ns/command\n"
+              << "(" << sink % 10 << ")\n";
+}
@@ -0,0 +1,108 @@
+// Task throughput of the work-stealing ThreadPool against the previous
+// single-queue pool (one mutex around a std::queue<std::function>), with
+// 1, 4, 16 and 64 threads submitting tiny tasks at once.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 -pthread bench/thread_pool_bench.cpp -o thread_pool_bench
+
+#include "../concurrency_managers.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+// The pool as it was before work stealing
+class LegacyThreadPool {
+public:
+    explicit LegacyThreadPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this] {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(queue_mutex);
+                        condition.wait(lock, [this] { return stop_flag || !tasks.empty(); });
+                        if (stop_flag && tasks.empty()) return;
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ~LegacyThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stop_flag = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    void enqueue(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            tasks.emplace(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    bool stop_flag = false;
+};
+
+// Tasks per second from submission of the first task to completion of the last
+template <typename Pool>
+double tasksPerSecond(size_t workers, size_t producers, size_t total_tasks) {
+    Pool pool(workers);
+    std::atomic<size_t> done{0};
+    std::atomic<bool> go{false};
+    size_t per_producer = total_tasks / producers;
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            while (!go) std::this_thread::yield();
+            for (size_t i = 0; i < per_producer; ++i) {
+                // Captures the same few words a server task carries
+                pool.enqueue([&done, a = i, b = p] { done.fetch_add(1 + (a & b & 0)); });
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& thread : threads) thread.join();
+    while (done.load() < per_producer * producers) std::this_thread::yield();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return per_producer * producers / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t workers = argc > 1 ? std::stoul(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    size_t total_tasks = argc > 2 ? std::stoul(argv[2]) : 1000000;
+
+    std::cout << "cores " << std::thread::hardware_concurrency() << ", " << workers << " workers, "
+              << total_tasks << " tasks\n"
+              << "producers   single queue (tasks/s)   work stealing (tasks/s)   speedup\n"
+              << std::fixed;
+    for (size_t producers : {1, 4, 16, 64}) {
+        double legacy = tasksPerSecond<LegacyThreadPool>(workers, producers, total_tasks);
+        double stealing = tasksPerSecond<ThreadPool>(workers, producers, total_tasks);
+        std::cout << std::setw(9) << producers
+                  << std::setprecision(0) << std::setw(25) << legacy
+                  << std::setw(26) << stealing
+                  << std::setprecision(2) << std::setw(10) << stealing / legacy << "x\n";
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Trade apply throughput as threads are added, with every trade behind one
+// global mutex (the old trade_mutex) against per-account striped locks.
+// Each thread trades for its own user, so with striping they should only
+// meet on the holdings store shards.
+//
+// The timed section is what buyStock does under its lock: read the
+// position, write the new one and format the log record. The disk flush is
+// left out; it happens after the lock is released.
+//
+// Build from backend/:
+//   g++ -std=c++17 -O2 -pthread bench/trade_contention_bench.cpp utils/holdings_store.cpp utils/csv.cpp utils/metrics.cpp utils/snapshot.cpp -o trade_contention_bench
+
+#include "../concurrency_managers.h"
+#include "../utils/holdings_store.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* TICKERS[] = {"AAPL", "MSFT", "GOOGL", "AMZN", "TSLA"};
+
+size_t applyTrade(HoldingsStore& holdings, const std::string& username, size_t i) {
+    const std::string ticker = TICKERS[i % 5];
+    int newQty = holdings.getQuantity(username, ticker).value_or(0) + 1;
+    holdings.setQuantity(username, ticker, newQty);
+    std::string record = username + ",BUY," + ticker + ",1," + std::to_string(172.35f);
+    return record.size();
+}
+
+template <typename LockFor>
+double tradesPerSecond(size_t threads, size_t trades_per_thread, LockFor lockFor) {
+    HoldingsStore holdings("/nonexistent/holdings.csv");
+    std::atomic<size_t> sink{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::string username = "bench_user_" + std::to_string(t);
+            size_t local = 0;
+            while (!go) std::this_thread::yield();
+            for (size_t i = 0; i < trades_per_thread; ++i) {
+                std::lock_guard<std::mutex> lock(lockFor(username));
+                local += applyTrade(holdings, username, i);
+            }
+            sink += local;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (auto& worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return threads * trades_per_thread / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::max(4u, 2 * std::thread::hardware_concurrency());
+    size_t trades_per_thread = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+    std::mutex global_mutex;
+    StripedMutex<> account_locks;
+
+    std::cout << "cores " << std::thread::hardware_concurrency()
+              << ", " << trades_per_thread << " trades per thread\n"
+              << "threads   global mutex (trades/s)   striped (trades/s)   speedup\n"
+              << std::fixed;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double global = tradesPerSecond(threads, trades_per_thread,
+                                        [&](const std::string&) -> std::mutex& { return global_mutex; });
+        double striped = tradesPerSecond(threads, trades_per_thread,
+                                         [&](const std::string& username) -> std::mutex& {
+                                             return account_locks.forKey(username);
+                                         });
+        std::cout << std::setw(7) << threads
+                  << std::setprecision(0) << std::setw(26) << global
+                  << std::setw(21) << striped
+                  << std::setprecision(2) << std::setw(10) << striped / global << "x\n";
+    }
+    return 0;
+}
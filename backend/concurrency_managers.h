@@ -11,36 +11,183 @@
 #include <memory>
 #include <stdexcept>
 #include <chrono>
+#include <future>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <array>
+#include <string>
 
+// Move-only callable with inline storage. Callables up to INLINE_SIZE
+// bytes live inside the Task itself, so queuing one does not allocate the
+// way std::function does; larger ones fall back to the heap. The size fits
+// the event loop's worker jobs (connection, timestamp and a request's
+// bytes plus a session) and keeps a queue cell at two cache lines.
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 112;
+
+    Task() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Fn>) {
+            new (storage) Fn(std::forward<F>(f));
+            ops = &InlineOps<Fn>::table;
+        } else {
+            *reinterpret_cast<Fn**>(storage) = new Fn(std::forward<F>(f));
+            ops = &HeapOps<Fn>::table;
+        }
+    }
+
+    Task(Task&& other) noexcept { moveFrom(other); }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+    void operator()() { ops->invoke(storage); }
+
+    void reset() {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* from, void* to);  // leaves `from` destroyed
+        void (*destroy)(void* storage);
+    };
+
+    template <typename Fn>
+    struct InlineOps {
+        static void invoke(void* s) { (*static_cast<Fn*>(s))(); }
+        static void move(void* from, void* to) {
+            new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        }
+        static void destroy(void* s) { static_cast<Fn*>(s)->~Fn(); }
+        static constexpr Ops table{invoke, move, destroy};
+    };
+
+    template <typename Fn>
+    struct HeapOps {
+        static void invoke(void* s) { (**static_cast<Fn**>(s))(); }
+        static void move(void* from, void* to) { *static_cast<Fn**>(to) = *static_cast<Fn**>(from); }
+        static void destroy(void* s) { delete *static_cast<Fn**>(s); }
+        static constexpr Ops table{invoke, move, destroy};
+    };
+
+    void moveFrom(Task& other) {
+        ops = other.ops;
+        if (ops) {
+            ops->move(other.storage, storage);
+            other.ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    const Ops* ops = nullptr;
+};
+
+// Bounded lock-free multi-producer multi-consumer ring of Tasks (Vyukov's
+// design: each cell carries a sequence number that says whether it is free
+// for the next push or holds a value for the next pop, so a cell is claimed
+// with one CAS before it is touched).
+class TaskQueue {
+public:
+    explicit TaskQueue(size_t capacity) : mask(capacity - 1), cells(new Cell[capacity]) {
+        for (size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Moves from task and returns true, or returns false if the ring is full
+    bool push(Task& task) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.task = std::move(task);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(Task& task) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    task = std::move(cell.task);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        Task task;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
+
+// Work-stealing pool. Every worker has its own lock-free queue; producers
+// spread tasks over the queues (a worker submitting more work keeps it on
+// its own queue) and a worker whose queue is empty steals from the others
+// before going to sleep. Only the rare overflow path and sleeping take a
+// mutex, so producers and workers do not all contend on one lock.
 class ThreadPool {
 public:
     explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
-        for(size_t i = 0; i < threads; ++i) {
-            workers.emplace_back([this] {
-                while(true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        
-                        // Wait for tasks or stop signal
-                        this->condition.wait(lock, [this] {
-                            return this->stop_flag || !this->tasks.empty();
-                        });
-
-                        // Exit if stopped and no tasks
-                        if(this->stop_flag && this->tasks.empty()) {
-                            return;
-                        }
-
-                        // Get the task
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    // Execute the task
-                    task();
-                }
-            });
+        threads = std::max<size_t>(1, threads);
+        for (size_t i = 0; i < threads; ++i) {
+            queues.push_back(std::make_unique<TaskQueue>(QUEUE_CAPACITY));
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
         }
     }
 
@@ -48,23 +195,84 @@ public:
         stop();
     }
 
-    void enqueue(std::function<void()> task) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            if(stop_flag) {
-                throw std::runtime_error("Enqueue on stopped ThreadPool");
+    template <typename F>
+    void enqueue(F&& task) {
+        if (stop_flag) {
+            throw std::runtime_error("Enqueue on stopped ThreadPool");
+        }
+        push(Task(std::forward<F>(task)));
+    }
+
+    // Run f on the pool; the future carries its result or exception
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        std::promise<Result> promise;
+        auto future = promise.get_future();
+        enqueue([promise = std::move(promise), f = std::forward<F>(f)]() mutable {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    f();
+                    promise.set_value();
+                } else {
+                    promise.set_value(f());
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
             }
-            tasks.emplace(std::move(task));
+        });
+        return future;
+    }
+
+    // Run body(0) .. body(count - 1) on the pool and return once all have
+    // finished. The calling thread claims indexes too and only waits for
+    // ones already running, so a worker may call this without deadlocking
+    // when every other worker is busy. body must not throw.
+    template <typename F>
+    void parallelFor(size_t count, F&& body) {
+        struct State {
+            std::atomic<size_t> next{0};
+            size_t finished = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto state = std::make_shared<State>();
+        auto* fn = &body;
+        auto run = [count, fn](State& s) {
+            size_t ran = 0;
+            for (size_t i = s.next.fetch_add(1); i < count; i = s.next.fetch_add(1)) {
+                (*fn)(i);
+                ++ran;
+            }
+            if (ran == 0) return;
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.finished += ran;
+            if (s.finished == count) s.done.notify_all();
+        };
+
+        // Helpers that start after every index is claimed return at once
+        // without touching body, which may be gone by then
+        for (size_t i = 1; i < count && !stop_flag; ++i) {
+            enqueue([state, run] { run(*state); });
         }
-        condition.notify_one();
+        run(*state);
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&] { return state->finished == count; });
     }
 
+    // Tasks waiting for a worker
+    size_t queued() const {
+        long n = pending.load();
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+    // Finish the queued tasks, then join the workers
     void stop() {
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
+            std::unique_lock<std::mutex> lock(park_mutex);
             stop_flag = true;
         }
-        condition.notify_all();
+        park_cv.notify_all();
 
         // Wait for all threads to finish
         for(auto& worker : workers) {
@@ -75,50 +283,260 @@ public:
     }
 
 private:
+    static constexpr size_t QUEUE_CAPACITY = 1024;  // per worker, power of two
+    static constexpr int SPINS_BEFORE_SLEEP = 64;
+
+    // Index of the pool worker running on this thread, or -1
+    static int& currentWorker() {
+        thread_local int index = -1;
+        return index;
+    }
+
+    void push(Task task) {
+        size_t count = queues.size();
+        int self = currentWorker();
+        size_t start = (self >= 0 && owner() == this) ? static_cast<size_t>(self) : producerSlot() % count;
+
+        bool queued = false;
+        for (size_t i = 0; i < count && !queued; ++i) {
+            queued = queues[(start + i) % count]->push(task);
+        }
+        if (!queued) {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            overflow.push(std::move(task));
+            overflow_size.fetch_add(1);
+        }
+
+        pending.fetch_add(1);
+        if (sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            park_cv.notify_one();
+        }
+    }
+
+    // Each producer thread walks the queues from its own starting point so
+    // producers do not share a round-robin counter
+    static size_t producerSlot() {
+        static std::atomic<size_t> next_producer{0};
+        thread_local size_t slot = next_producer.fetch_add(1);
+        return slot++;
+    }
+
+    static ThreadPool*& owner() {
+        thread_local ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    bool tryTake(size_t self, Task& task) {
+        size_t count = queues.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (queues[(self + i) % count]->pop(task)) return true;  // own queue first, then steal
+        }
+        if (overflow_size.load() > 0) {
+            std::lock_guard<std::mutex> lock(overflow_mutex);
+            if (!overflow.empty()) {
+                task = std::move(overflow.front());
+                overflow.pop();
+                overflow_size.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        currentWorker() = static_cast<int>(self);
+        owner() = this;
+        Task task;
+        int idle_spins = 0;
+
+        while (true) {
+            if (tryTake(self, task)) {
+                pending.fetch_sub(1);
+                idle_spins = 0;
+                task();
+                task.reset();
+                continue;
+            }
+            if (++idle_spins < SPINS_BEFORE_SLEEP) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Sleep until work arrives; `pending` is raised before the
+            // producer looks at `sleeping`, so a wakeup cannot be missed
+            std::unique_lock<std::mutex> lock(park_mutex);
+            sleeping.fetch_add(1);
+            park_cv.wait(lock, [this] { return stop_flag || pending.load() > 0; });
+            sleeping.fetch_sub(1);
+            idle_spins = 0;
+            if (stop_flag && pending.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queue_mutex;
-    std::condition_variable condition;
+
+    std::mutex overflow_mutex;  // only used when every queue is full
+    std::queue<Task> overflow;
+    std::atomic<size_t> overflow_size{0};
+
+    std::atomic<long> pending{0};  // queued, not yet taken (may dip below zero briefly)
+    std::atomic<int> sleeping{0};
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
     std::atomic<bool> stop_flag{false};
 };
 
+// Non-blocking admission control, shared by every accept path.
+//
+// Connections are counted against a global cap and a per-IP quota with
+// plain atomic counters; addresses hash into a fixed table, so two that
+// share a slot share a quota. Over either limit the caller rejects the
+// client at once (503) rather than holding up the listener.
+//
+// Requests that go to the worker pool are admitted against a concurrency
+// limit that adapts to their measured latency (the gradient between the
+// long-run and recent average latency, after Netflix's concurrency-limits
+// "gradient2"). When queueing inflates latency the limit shrinks and the
+// excess is shed with 503, which keeps tail latency bounded; when latency
+// recovers the limit grows back.
 class ConnectionManager {
 public:
-    explicit ConnectionManager(int max_connections = 100) 
-        : max_connections(max_connections) {}
-    
-    bool acquire_connection() {
-        std::unique_lock<std::mutex> lock(connection_mutex);
-        
-        // Wait if max connections reached
-        bool acquired = connection_cv.wait_for(lock, 
-            std::chrono::seconds(10), 
-            [this] { 
-                return current_connections < max_connections; 
-            }
-        );
+    explicit ConnectionManager(int max_connections = 100, int max_per_ip = 100,
+                               int initial_request_limit = 20, int min_request_limit = 10,
+                               int max_request_limit = 1000)
+        : max_connections(max_connections), max_per_ip(max_per_ip),
+          min_request_limit(min_request_limit), max_request_limit(max_request_limit),
+          request_limit(initial_request_limit), estimated_limit(initial_request_limit) {}
 
-        if(acquired) {
-            ++current_connections;
-            return true;
+    // Never blocks; false means the client should be turned away
+    bool acquire_connection(uint32_t ip = 0) {
+        if (current_connections.fetch_add(1) >= max_connections) {
+            current_connections.fetch_sub(1);
+            ++rejected_connections;
+            return false;
         }
-        
-        return false;
+        std::atomic<int>& slot = ip_connections[ipSlot(ip)];
+        if (slot.fetch_add(1) >= max_per_ip) {
+            slot.fetch_sub(1);
+            current_connections.fetch_sub(1);
+            ++rejected_connections;
+            return false;
+        }
+        return true;
     }
 
-    void release_connection() {
-        {
-            std::unique_lock<std::mutex> lock(connection_mutex);
-            --current_connections;
+    void release_connection(uint32_t ip = 0) {
+        ip_connections[ipSlot(ip)].fetch_sub(1);
+        current_connections.fetch_sub(1);
+    }
+
+    // Admit one request to the worker pool; false means shed it
+    bool try_begin_request() {
+        if (in_flight.fetch_add(1) >= request_limit.load(std::memory_order_relaxed)) {
+            in_flight.fetch_sub(1);
+            ++shed_requests;
+            return false;
+        }
+        return true;
+    }
+
+    // Report an admitted request as done; latency runs from admission
+    // (so it includes time spent queued) to its response being ready
+    void end_request(std::chrono::steady_clock::duration latency) {
+        in_flight.fetch_sub(1);
+        window_latency_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        if (window_samples.fetch_add(1) + 1 >= SAMPLE_WINDOW) {
+            updateLimit();
         }
-        connection_cv.notify_one();
     }
 
+    int connections() const { return current_connections.load(); }
+    int requests_in_flight() const { return in_flight.load(); }  // queued plus running
+    int current_request_limit() const { return request_limit.load(); }
+    uint64_t connections_rejected() const { return rejected_connections.load(); }
+    uint64_t requests_shed() const { return shed_requests.load(); }
+
 private:
+    static constexpr size_t IP_SLOTS = 4096;
+    static constexpr uint64_t SAMPLE_WINDOW = 50;     // requests per limit update
+    static constexpr double LONG_WINDOW = 20.0;       // sample windows in the long-run average
+    static constexpr double SMOOTHING = 0.2;
+
+    static size_t ipSlot(uint32_t ip) {
+        return (ip * 2654435761u) % IP_SLOTS;
+    }
+
+    // Run by whichever request closes a sample window; if another thread
+    // is already updating, this window's samples roll into the next one
+    void updateLimit() {
+        if (updating.exchange(true)) return;
+        uint64_t samples = window_samples.exchange(0);
+        uint64_t total_ns = window_latency_ns.exchange(0);
+        if (samples > 0) {
+            double recent = static_cast<double>(total_ns) / samples;
+            long_latency = long_latency == 0 ? recent
+                                             : long_latency + (recent - long_latency) / LONG_WINDOW;
+            // After a slow spell, let the baseline come back down quickly
+            if (long_latency > 2 * recent) long_latency *= 0.95;
+
+            // Only move the limit when it is actually being used
+            if (in_flight.load() >= estimated_limit / 2) {
+                double gradient = std::max(0.5, std::min(1.0, long_latency / std::max(recent, 1.0)));
+                double target = estimated_limit * gradient + std::sqrt(estimated_limit);
+                estimated_limit = estimated_limit * (1 - SMOOTHING) + target * SMOOTHING;
+                estimated_limit = std::max<double>(min_request_limit, std::min<double>(max_request_limit, estimated_limit));
+                request_limit.store(static_cast<int>(estimated_limit));
+            }
+        }
+        updating.store(false);
+    }
+
     const int max_connections;
+    const int max_per_ip;
+    const int min_request_limit;
+    const int max_request_limit;
+
     std::atomic<int> current_connections{0};
-    std::mutex connection_mutex;
-    std::condition_variable connection_cv;
+    std::atomic<int> ip_connections[IP_SLOTS] = {};
+    std::atomic<uint64_t> rejected_connections{0};
+
+    std::atomic<int> in_flight{0};
+    std::atomic<int> request_limit;
+    std::atomic<uint64_t> shed_requests{0};
+    std::atomic<uint64_t> window_samples{0};
+    std::atomic<uint64_t> window_latency_ns{0};
+    std::atomic<bool> updating{false};
+    double estimated_limit;    // only touched while `updating` is held
+    double long_latency = 0;
+};
+
+// Fixed set of mutexes picked by hashing a key. Work on the same key is
+// serialized; work on different keys only contends when two keys share a
+// stripe. Each stripe has its own cache line so neighbours do not bounce.
+template <size_t Stripes = 64>
+class StripedMutex {
+public:
+    static size_t stripeOf(const std::string& key) {
+        return std::hash<std::string>{}(key) % Stripes;
+    }
+
+    std::mutex& forKey(const std::string& key) {
+        return stripes[stripeOf(key)].mutex;
+    }
+
+    std::mutex& stripe(size_t index) {
+        return stripes[index].mutex;
+    }
+
+private:
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+    };
+    std::array<Stripe, Stripes> stripes;
 };
 
 #endif // CONCURRENCY_MANAGERS_H
\ No newline at end of file
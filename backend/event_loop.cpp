@@ -0,0 +1,533 @@
+#include "event_loop.h"
+#include "utils/metrics.h"
+
+#ifdef __linux__
+
+#include "utils/logger.h"
+#include "utils/binary_protocol.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+const int MAX_EVENTS = 256;
+// Idle keep-alive connections are closed after this long
+const auto KEEP_ALIVE_TIMEOUT = std::chrono::seconds(60);
+const auto IDLE_SWEEP_INTERVAL = std::chrono::seconds(5);
+// Stream subscribers get a comment line this often so dead peers are noticed
+const auto HEARTBEAT_INTERVAL = std::chrono::seconds(15);
+// A subscriber this many frames behind is too slow and is disconnected
+const size_t MAX_QUEUED_FRAMES = 256;
+
+namespace {
+
+int createListenSocket(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        LOG_ERROR("SO_REUSEPORT failed: " << errno);
+        close(fd);
+        return -1;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LOG_ERROR("Bind failed: Port " << port << ", Error: " << errno);
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        LOG_ERROR("Listen failed: " << errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace
+
+EventLoop::EventLoop(int port, const HttpLimits& limits, ThreadPool& workers, ConnectionManager& admission,
+                     Handler handler, BlockingCheck mayBlock, StreamOpen openStream, FrameHandler frame_handler)
+    : limits(limits), workers(workers), admission(admission), handler(std::move(handler)),
+      mayBlock(std::move(mayBlock)), openStream(std::move(openStream)), frame_handler(std::move(frame_handler)) {
+    listen_fd = createListenSocket(port);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd < 0 || epoll_fd < 0 || wake_fd < 0) {
+        if (listen_fd >= 0) close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+}
+
+EventLoop::~EventLoop() {
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    if (listen_fd >= 0) close(listen_fd);
+    if (wake_fd >= 0) close(wake_fd);
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+void EventLoop::run() {
+    running = true;
+    epoll_event events[MAX_EVENTS];
+
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait failed: " << errno);
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == wake_fd) {
+                drainWakeups();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(conn);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                handleWritable(conn);
+                if (connections.find(fd) == connections.end()) continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                handleReadable(conn);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sweep >= IDLE_SWEEP_INTERVAL) {
+            closeIdleConnections(now);
+            last_sweep = now;
+        }
+    }
+}
+
+// Close keep-alive connections that have been silent for too long, and
+// send stream subscribers (which never speak) a heartbeat instead
+void EventLoop::closeIdleConnections(std::chrono::steady_clock::time_point now) {
+    std::vector<int> idle;
+    for (const auto& entry : connections) {
+        const Connection& conn = entry.second;
+        if (!conn.streaming && !conn.busy && conn.out.empty() && now - conn.last_active >= KEEP_ALIVE_TIMEOUT) {
+            idle.push_back(entry.first);
+        }
+    }
+    for (int fd : idle) {
+        closeConnection(connections[fd]);
+    }
+
+    if (!subscribers.empty() && now - last_heartbeat >= HEARTBEAT_INTERVAL) {
+        static const auto heartbeat = std::make_shared<const std::string>(": heartbeat\n\n");
+        std::vector<int> fds(subscribers.begin(), subscribers.end());
+        for (int fd : fds) {
+            auto it = connections.find(fd);
+            if (it != connections.end()) sendFrame(it->second, heartbeat);
+        }
+        last_heartbeat = now;
+    }
+}
+
+void EventLoop::broadcast(std::shared_ptr<const std::string> frame) {
+    runInLoop([this, frame = std::move(frame)] {
+        // sendFrame may close a subscriber, so iterate over a copy
+        std::vector<int> fds(subscribers.begin(), subscribers.end());
+        for (int fd : fds) {
+            auto it = connections.find(fd);
+            if (it != connections.end()) sendFrame(it->second, frame);
+        }
+    });
+}
+
+void EventLoop::sendFrame(Connection& conn, const std::shared_ptr<const std::string>& frame) {
+    if (conn.frames.size() >= MAX_QUEUED_FRAMES) {
+        closeConnection(conn);  // the client reconnects and gets a fresh snapshot
+        return;
+    }
+    conn.frames.push_back(frame);
+    if (conn.frames.size() == 1 && conn.out.empty()) {
+        handleWritable(conn);
+    }
+}
+
+void EventLoop::stop() {
+    running = false;
+    runInLoop([] {});
+}
+
+void EventLoop::runInLoop(Task fn) {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.push_back(std::move(fn));
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void EventLoop::drainWakeups() {
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) > 0) {}
+
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        tasks.swap(pending);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::acceptConnections() {
+    while (true) {
+        sockaddr_in peer{};
+        socklen_t peer_len = sizeof(peer);
+        int fd = accept4(listen_fd, (struct sockaddr*)&peer, &peer_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Accept failed: " << errno);
+            }
+            return;
+        }
+
+        uint32_t ip = ntohl(peer.sin_addr.s_addr);
+        if (!admission.acquire_connection(ip)) {
+            // Best effort: a fresh socket's send buffer always has room for this
+            static const std::string rejection = httpErrorResponse(503);
+            send(fd, rejection.data(), rejection.size(), MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            admission.release_connection(ip);
+            close(fd);
+            continue;
+        }
+
+        Connection& conn = connections[fd];
+        conn = Connection();
+        conn.fd = fd;
+        conn.id = next_connection_id++;
+        conn.ip = ip;
+        conn.parser = HttpParser(limits);
+        conn.last_active = std::chrono::steady_clock::now();
+    }
+}
+
+void EventLoop::handleReadable(Connection& conn) {
+    // Never buffer more than one maximum-size request beyond what was parsed
+    const size_t max_buffered = limits.max_request_line + limits.max_header_bytes + limits.max_body;
+    char buffer[16384];
+    bool peer_closed = false;
+
+    while (true) {
+        ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            if (conn.in.size() - conn.in_start > max_buffered) {
+                closeConnection(conn);
+                return;
+            }
+            continue;
+        }
+        if (n == 0) {
+            peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        closeConnection(conn);
+        return;
+    }
+
+    conn.last_active = std::chrono::steady_clock::now();
+    if (peer_closed) {
+        // No more requests can arrive; answer the complete ones, then close
+        conn.read_closed = true;
+    }
+    processInput(conn);
+}
+
+// Answer buffered requests in arrival order. Requests that cannot block are
+// answered inline; the first one that may block goes to a worker and the
+// rest of the pipeline waits until its response has been queued, so
+// responses (and the trades behind them) keep the order the client sent.
+// May close the connection; callers must not touch conn afterwards.
+void EventLoop::processInput(Connection& conn) {
+    if (conn.streaming) {
+        conn.in.clear();  // subscribers have nothing more to say
+        conn.in_start = 0;
+    }
+
+    if (conn.protocol == Protocol::UNKNOWN) negotiate(conn);
+    bool open = conn.protocol == Protocol::HTTP     ? processRequests(conn)
+                : conn.protocol == Protocol::BINARY ? processFrames(conn)
+                                                    : true;
+    if (!open) return;
+
+    // Reuse the buffer: rewind when drained, shift only once mostly consumed
+    if (conn.closing || conn.in_start == conn.in.size()) {
+        conn.in.clear();
+        conn.in_start = 0;
+    } else if (conn.in_start > conn.in.size() / 2) {
+        conn.in.erase(0, conn.in_start);
+        conn.in_start = 0;
+    }
+
+    if (conn.read_closed && !conn.busy) {
+        conn.closing = true;
+    }
+    handleWritable(conn);
+}
+
+// A connection that starts with the binary protocol's magic bytes speaks
+// frames from then on (the magic is echoed back to confirm); anything else
+// is HTTP. Decided on the first bytes, waiting for the whole magic if it
+// arrives split.
+void EventLoop::negotiate(Connection& conn) {
+    using binary_protocol::MAGIC;
+    using binary_protocol::MAGIC_SIZE;
+
+    size_t buffered = conn.in.size() - conn.in_start;
+    if (buffered == 0) return;
+    const char* data = conn.in.data() + conn.in_start;
+    if (!frame_handler.handle || data[0] != MAGIC[0]) {
+        conn.protocol = Protocol::HTTP;
+        return;
+    }
+    if (std::memcmp(data, MAGIC, std::min(buffered, MAGIC_SIZE)) != 0) {
+        conn.closing = true;  // another version, or garbage
+        return;
+    }
+    if (buffered < MAGIC_SIZE) return;
+
+    conn.protocol = Protocol::BINARY;
+    conn.in_start += MAGIC_SIZE;
+    conn.out.append(MAGIC, MAGIC_SIZE);
+}
+
+// Both return false if they closed the connection
+bool EventLoop::processRequests(Connection& conn) {
+    while (!conn.busy && !conn.closing && !conn.streaming && conn.in_start < conn.in.size()) {
+        std::string_view buffered(conn.in.data() + conn.in_start, conn.in.size() - conn.in_start);
+        HttpParser::Status status = conn.parser.parse(buffered);
+        if (status == HttpParser::Status::Incomplete) break;
+        if (status == HttpParser::Status::Error) {
+            conn.out += httpErrorResponse(conn.parser.errorStatus());
+            conn.closing = true;
+            break;
+        }
+
+        const HttpRequest& request = conn.parser.request();
+        size_t length = request.size();
+        if (!request.keepAlive()) {
+            conn.closing = true;
+        }
+
+        std::string preamble;
+        if (openStream && openStream(request, preamble)) {
+            conn.out += preamble;
+            conn.streaming = true;
+            conn.closing = false;
+            subscribers.insert(conn.fd);
+        } else if (!mayBlock(request)) {
+            conn.out += handler(request);
+        } else if (!admission.try_begin_request()) {
+            // Over the adaptive limit: shed now rather than queue behind the backlog
+            conn.out += httpErrorResponse(503);
+            conn.closing = true;
+        } else {
+            // The worker gets its own copy of the bytes (this buffer keeps
+            // changing) and parses them again: cheaper than carrying the
+            // header table, and the task stays within Task's inline storage
+            std::string raw(buffered.substr(0, length));
+            bool queued = runOnWorker(conn, [this, raw = std::move(raw)] {
+                HttpParser parser(limits);
+                parser.parse(raw);
+                return handler(parser.request());
+            });
+            if (!queued) return false;
+        }
+
+        conn.in_start += length;
+        conn.parser.reset();
+    }
+    return true;
+}
+
+// Frames are answered like pipelined requests: in order, with the ones
+// that may block handed to a worker. A frame with an impossible length
+// closes the connection, since the stream cannot be resynchronized.
+bool EventLoop::processFrames(Connection& conn) {
+    using namespace binary_protocol;
+
+    while (!conn.busy && !conn.closing && conn.in.size() - conn.in_start >= HEADER_SIZE) {
+        const char* data = conn.in.data() + conn.in_start;
+        uint32_t length = frameLength(data);
+        if (length < HEADER_SIZE || length > MAX_FRAME) {
+            conn.closing = true;
+            break;
+        }
+        if (conn.in.size() - conn.in_start < length) break;
+
+        std::string_view frame(data, length);
+        if (!frame_handler.mayBlock || !frame_handler.mayBlock(frame)) {
+            frame_handler.handle(frame, conn.session, conn.out);
+        } else if (!admission.try_begin_request()) {
+            appendStatus(conn.out, frame, BUSY);  // the client may retry; the stream stays usable
+        } else {
+            bool queued = runOnWorker(conn, [this, raw = std::string(frame), session = conn.session]() mutable {
+                std::string reply;
+                frame_handler.handle(raw, session, reply);
+                return reply;
+            });
+            if (!queued) return false;
+        }
+        conn.in_start += length;
+    }
+    return true;
+}
+
+// Run work, admitted by the caller, on a worker and queue its result as
+// conn's next output; conn stays busy until then. False (with conn closed)
+// if the pool refused it. Neither the job nor the delivery allocates
+// beyond what work itself captured.
+template <typename Work>
+bool EventLoop::runOnWorker(Connection& conn, Work&& work) {
+    conn.busy = true;
+    int fd = conn.fd;
+    uint64_t id = conn.id;
+    auto admitted = std::chrono::steady_clock::now();
+    try {
+        auto job = [this, fd, id, admitted, work = std::forward<Work>(work)]() mutable {
+            static const LatencyHistogram queue_wait("server_threadpool_queue_wait_seconds", "",
+                                                     "Time a request waited for a worker");
+            queue_wait.observe(std::chrono::steady_clock::now() - admitted);
+            std::string response;
+            try {
+                response = work();
+            } catch (const std::exception& e) {
+                LOG_ERROR("Error handling client: " << e.what());
+            }
+            admission.end_request(std::chrono::steady_clock::now() - admitted);
+            runInLoop([this, fd, id, response = std::move(response)]() mutable {
+                deliver(fd, id, std::move(response));
+            });
+        };
+        static_assert(sizeof(job) <= Task::INLINE_SIZE, "worker jobs must fit in a Task without allocating");
+        workers.enqueue(std::move(job));
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error handling client: " << e.what());
+        admission.end_request(std::chrono::steady_clock::now() - admitted);
+        closeConnection(conn);
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::deliver(int fd, uint64_t id, std::string response) {
+    auto it = connections.find(fd);
+    if (it == connections.end() || it->second.id != id) return;  // client went away
+
+    Connection& conn = it->second;
+    conn.busy = false;
+    if (response.empty()) {
+        closeConnection(conn);
+        return;
+    }
+    conn.out += response;
+    processInput(conn);
+}
+
+void EventLoop::handleWritable(Connection& conn) {
+    while (conn.out_offset < conn.out.size()) {
+        ssize_t n = send(conn.fd, conn.out.data() + conn.out_offset,
+                         conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out_offset += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;  // wait for EPOLLOUT
+        closeConnection(conn);
+        return;
+    }
+
+    conn.out.clear();
+    conn.out_offset = 0;
+
+    while (!conn.frames.empty()) {
+        const std::string& frame = *conn.frames.front();
+        ssize_t n = send(conn.fd, frame.data() + conn.frame_offset,
+                         frame.size() - conn.frame_offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.frame_offset += n;
+            if (conn.frame_offset == frame.size()) {
+                conn.frames.pop_front();
+                conn.frame_offset = 0;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        closeConnection(conn);
+        return;
+    }
+
+    if (conn.closing && !conn.busy) {
+        closeConnection(conn);
+    }
+}
+
+void EventLoop::closeConnection(Connection& conn) {
+    int fd = conn.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    admission.release_connection(conn.ip);
+    subscribers.erase(fd);
+    connections.erase(fd);
+}
+
+#endif // __linux__
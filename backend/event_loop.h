@@ -0,0 +1,132 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#ifdef __linux__
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include "concurrency_managers.h"
+#include "utils/http_parser.h"
+
+// Non-blocking epoll reactor for one core.
+//
+// Every loop owns its own SO_REUSEPORT listening socket, so the kernel
+// spreads new connections across loops and no accept lock is shared.
+// Sockets are edge-triggered; requests are read and answered on the loop
+// thread, and only requests that may block (disk, fsync) are handed to the
+// worker pool, whose result is posted back to the loop that owns the socket.
+// New connections and pooled requests pass the shared ConnectionManager
+// first; anything it turns away gets an immediate 503.
+// Connections are persistent (HTTP/1.1 keep-alive) and pipelined requests
+// are answered in order. A connection can instead subscribe to a push
+// stream, after which it only receives broadcast frames, or open with the
+// binary protocol's magic bytes (utils/binary_protocol.h) and exchange
+// length-prefixed frames instead of HTTP.
+class EventLoop {
+public:
+    // Builds the full HTTP response for one request
+    using Handler = std::function<std::string(const HttpRequest& request)>;
+    // True if handling the request may block and belongs on a worker
+    using BlockingCheck = std::function<bool(const HttpRequest& request)>;
+    // True if the request subscribes to a server-push stream; fills in the
+    // response headers and first event to send
+    using StreamOpen = std::function<bool(const HttpRequest& request, std::string& preamble)>;
+
+    // Binary protocol frames; without a handle function connections are
+    // always HTTP
+    struct FrameHandler {
+        // True if handling the frame may block and belongs on a worker
+        std::function<bool(std::string_view frame)> mayBlock;
+        // Append the reply to out; session is the connection's state
+        // between frames (changes made on a worker are not kept)
+        std::function<void(std::string_view frame, std::string& session, std::string& out)> handle;
+    };
+
+    EventLoop(int port, const HttpLimits& limits, ThreadPool& workers, ConnectionManager& admission,
+              Handler handler, BlockingCheck mayBlock, StreamOpen openStream, FrameHandler frame_handler = {});
+    ~EventLoop();
+
+    bool listening() const { return listen_fd >= 0; }
+    void run();
+    void stop();
+
+    // Run fn on the loop thread (safe to call from any thread)
+    void runInLoop(Task fn);
+
+    // Queue one encoded frame on every stream subscriber of this loop. The
+    // same buffer is shared by all of them (safe to call from any thread).
+    void broadcast(std::shared_ptr<const std::string> frame);
+
+private:
+    enum class Protocol : uint8_t { UNKNOWN, HTTP, BINARY };
+
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;           // distinguishes reused descriptors
+        uint32_t ip = 0;           // peer IPv4 address, for per-IP quotas
+        std::string in;            // reused for every request on the connection
+        size_t in_start = 0;       // bytes of `in` already consumed
+        HttpParser parser;
+        std::string out;
+        size_t out_offset = 0;
+        bool busy = false;         // a request is being handled by a worker
+        bool read_closed = false;  // peer shut down its sending side
+        bool closing = false;      // close once the queued output is sent
+        bool streaming = false;    // subscribed to broadcasts; input is ignored
+        Protocol protocol = Protocol::UNKNOWN;  // decided by the first bytes received
+        std::string session;       // binary protocol: the logged-in user
+        std::deque<std::shared_ptr<const std::string>> frames;  // sent after `out`
+        size_t frame_offset = 0;
+        std::chrono::steady_clock::time_point last_active;
+    };
+
+    void acceptConnections();
+    void handleReadable(Connection& conn);
+    void handleWritable(Connection& conn);
+    void processInput(Connection& conn);
+    void negotiate(Connection& conn);
+    bool processRequests(Connection& conn);
+    bool processFrames(Connection& conn);
+    template <typename Work>
+    bool runOnWorker(Connection& conn, Work&& work);
+    void deliver(int fd, uint64_t id, std::string response);
+    void closeConnection(Connection& conn);
+    void closeIdleConnections(std::chrono::steady_clock::time_point now);
+    void sendFrame(Connection& conn, const std::shared_ptr<const std::string>& frame);
+    void drainWakeups();
+
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    const HttpLimits limits;
+    ThreadPool& workers;
+    ConnectionManager& admission;
+    Handler handler;
+    BlockingCheck mayBlock;
+    StreamOpen openStream;
+    FrameHandler frame_handler;
+
+    std::unordered_map<int, Connection> connections;
+    std::unordered_set<int> subscribers;
+    std::chrono::steady_clock::time_point last_heartbeat = std::chrono::steady_clock::now();
+    uint64_t next_connection_id = 1;
+    std::chrono::steady_clock::time_point last_sweep = std::chrono::steady_clock::now();
+
+    std::mutex pending_mutex;
+    std::vector<Task> pending;
+    std::atomic<bool> running{false};
+};
+
+#endif // __linux__
+
+#endif // EVENT_LOOP_H
@@ -1,12 +1,14 @@
 #include "auth.h"
-#include "../utils/csv.h"
-#include <vector>
-#include <mutex>
+#include "../utils/user_directory.h"
+#include "../utils/command_router.h"
+#include "../utils/http_parser.h"
 #include <algorithm> // for std::remove_if
+#include <unordered_map>
+#include <mutex>
+#include <ctime>
 
-std::mutex auth_mutex;
-const std::string USERS_FILE = "db/users.csv";
-
+static std::unordered_map<std::string, std::string> sessions;
+static std::mutex sessions_mutex;
 
 std::string trim(const std::string& str) {
     std::string result = str;
@@ -16,28 +18,50 @@ std::string trim(const std::string& str) {
     return result;
 }
 
+// Both are answered from the resident user directory; only registration
+// writes to users.csv.
+
 bool loginUser(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(auth_mutex);
-    auto users = readCSV(USERS_FILE);
-    for (auto& row : users) {
-        if (row.size() >= 2) {
-            std::string storedUser = trim(row[0]);
-            std::string storedPass = trim(row[1]);
-            if (storedUser == username && storedPass == password) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return userDirectory().authenticate(username, password);
 }
 
 
 bool registerUser(const std::string& username, const std::string& password) {
-    std::lock_guard<std::mutex> lock(auth_mutex);
-    auto users = readCSV(USERS_FILE);
-    for (auto& row : users) {
-        if (!row.empty() && trim(row[0]) == username) return false;
-    }
-    appendCSV(USERS_FILE, {trim(username), trim(password)});
-    return true;
+    return userDirectory().add(trim(username), trim(password));
+}
+
+std::string createSession(const std::string& username) {
+    // A simple session ID (for demo purposes only)
+    std::string sessionId = "session_" + username + "_" + std::to_string(std::time(nullptr));
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    sessions[sessionId] = username;
+    return sessionId;
+}
+
+std::string sessionUser(std::string_view session_id) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto it = sessions.find(std::string(session_id));
+    return it == sessions.end() ? std::string() : it->second;
+}
+
+void registerAuthCommands(CommandRouter& router) {
+    // The password is the rest of the line, '|' included
+    router.add(Command::LOGIN, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs& args, CommandContext& context) {
+        std::string username;
+        std::string_view password;
+        if (!args.next(username) || !args.rest(password) || username.empty() || password.empty()) {
+            return std::string("ERROR|Invalid format");
+        }
+        if (!loginUser(username, std::string(password))) return std::string("ERROR|Invalid credentials");
+        context.session_id = createSession(username);
+        return "OK|Logged in|" + username;
+    });
+    router.add(Command::REGISTER, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        std::string username;
+        std::string_view password;
+        if (!args.next(username) || !args.rest(password) || username.empty() || password.empty()) {
+            return std::string("ERROR|Invalid format");
+        }
+        return std::string(registerUser(username, std::string(password)) ? "OK|User registered" : "ERROR|User exists");
+    });
 }
@@ -2,8 +2,19 @@
 #define AUTH_H
 
 #include <string>
+#include <string_view>
+
+class CommandRouter;
 
 bool loginUser(const std::string& username, const std::string& password);
 bool registerUser(const std::string& username, const std::string& password);
 
+// Sessions issued by LOGIN, kept in memory: a new session id for a user,
+// and the user a session id belongs to ("" if unknown)
+std::string createSession(const std::string& username);
+std::string sessionUser(std::string_view session_id);
+
+// LOGIN|username|password and REGISTER|username|password
+void registerAuthCommands(CommandRouter& router);
+
 #endif
@@ -0,0 +1,193 @@
+#include "binary.h"
+#include "auth.h"
+#include "trade.h"
+#include "../utils/binary_protocol.h"
+#include "../utils/dictionary.h"
+#include "../utils/quote_table.h"
+#include "../utils/valuation.h"
+#include "../utils/metrics.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace binary_protocol;
+
+namespace {
+
+// Ticker ids handed to binary clients, assigned on first use and kept in
+// memory for the life of the process
+class TickerIds {
+public:
+    uint32_t intern(std::string_view ticker) {
+        if (auto id = names.find(ticker)) return *id;
+        std::lock_guard<std::mutex> lock(intern_mutex);  // NameDictionary takes one writer
+        return names.intern(ticker);
+    }
+
+    std::string name(uint32_t id) const { return names.name(id); }  // "" if unknown
+    size_t size() const { return names.size(); }
+
+    // The id of each of market's quotes, in quote order. Generations share
+    // their TickerIndex while the tickers stay the same, so this is only
+    // rebuilt when a ticker is added or the file is reloaded.
+    std::shared_ptr<const std::vector<uint32_t>> quoteIds(const MarketSnapshot& market) {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            if (cached_index == market.index && cached_ids) return cached_ids;
+        }
+        auto ids = std::make_shared<std::vector<uint32_t>>();
+        ids->reserve(market.quotes.size());
+        for (const auto& quote : market.quotes) ids->push_back(intern(quote.ticker));
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cached_index = market.index;
+        cached_ids = ids;
+        return ids;
+    }
+
+private:
+    NameDictionary names;  // never opened: memory only
+    std::mutex intern_mutex;
+    std::mutex cache_mutex;
+    std::shared_ptr<const TickerIndex> cached_index;
+    std::shared_ptr<const std::vector<uint32_t>> cached_ids;
+};
+
+TickerIds& tickerIds() {
+    static TickerIds ids;
+    return ids;
+}
+
+// Handling time per message type, excluding queueing; index 0 counts
+// unknown types
+const LatencyHistogram& durationOf(uint16_t type) {
+    static const std::vector<LatencyHistogram> histograms = [] {
+        const char* names[] = {"OTHER", "LOGIN", "SYMBOLS", "QUOTES", "BUY", "SELL", "PORTFOLIO"};
+        std::vector<LatencyHistogram> result;
+        for (const char* name : names) {
+            result.emplace_back("server_binary_duration_seconds", "type=\"" + std::string(name) + "\"",
+                                "Time to handle one binary protocol frame, excluding queueing");
+        }
+        return result;
+    }();
+    return histograms[type <= PORTFOLIO ? type : 0];
+}
+
+uint16_t login(const char* body, size_t size, std::string& session) {
+    if (size < 4) return BAD_FRAME;
+    uint16_t user_length = load<uint16_t>(body);
+    uint16_t password_length = load<uint16_t>(body + 2);
+    if (size != 4u + user_length + password_length) return BAD_FRAME;
+
+    std::string username(body + 4, user_length);
+    if (!loginUser(username, std::string(body + 4 + user_length, password_length))) return BAD_CREDENTIALS;
+    session = std::move(username);
+    return OK;
+}
+
+void symbols(uint64_t tag, std::string& out) {
+    tickerIds().quoteIds(*quoteTable().snapshot());  // every current ticker has an id
+
+    // Ids are dense and never reused, so list them in order
+    std::vector<std::string> tickers;
+    for (uint32_t id = 0; id < tickerIds().size(); ++id) tickers.push_back(tickerIds().name(id));
+    size_t body_size = 4;
+    for (const auto& ticker : tickers) body_size += 6 + ticker.size();
+
+    char* at = appendFrame(out, SYMBOLS, OK, tag, body_size);
+    store<uint32_t>(at, static_cast<uint32_t>(tickers.size()));
+    at += 4;
+    for (uint32_t id = 0; id < tickers.size(); ++id) {
+        store<uint32_t>(at, id);
+        store<uint16_t>(at + 4, static_cast<uint16_t>(tickers[id].size()));
+        std::memcpy(at + 6, tickers[id].data(), tickers[id].size());
+        at += 6 + tickers[id].size();
+    }
+}
+
+void quotes(uint64_t tag, std::string& out) {
+    auto market = quoteTable().snapshot();
+    auto ids = tickerIds().quoteIds(*market);
+
+    char* at = appendFrame(out, QUOTES, OK, tag, 8 + market->quotes.size() * sizeof(QuoteEntry));
+    store<uint32_t>(at, static_cast<uint32_t>(market->quotes.size()));
+    store<uint32_t>(at + 4, 0);
+    at += 8;
+    for (size_t i = 0; i < market->quotes.size(); ++i) {
+        store(at, QuoteEntry{(*ids)[i], 0, market->quotes[i].price});
+        at += sizeof(QuoteEntry);
+    }
+}
+
+uint16_t trade(bool buy, const char* body, size_t size, const std::string& session) {
+    if (size != sizeof(TradeBody)) return BAD_FRAME;
+    if (session.empty()) return NOT_LOGGED_IN;
+    TradeBody order = load<TradeBody>(body);
+    if (order.quantity <= 0) return REJECTED;
+    std::string ticker = tickerIds().name(order.ticker);
+    if (ticker.empty()) return UNKNOWN_TICKER;
+    bool ok = buy ? buyStock(session, ticker, order.quantity) : sellStock(session, ticker, order.quantity);
+    return ok ? OK : REJECTED;
+}
+
+void portfolio(uint64_t tag, const std::string& session, std::string& out) {
+    std::vector<PositionValue> positions = valuationEngine().portfolio(session);
+
+    char* at = appendFrame(out, PORTFOLIO, OK, tag, 8 + positions.size() * sizeof(PositionEntry));
+    store<uint32_t>(at, static_cast<uint32_t>(positions.size()));
+    store<uint32_t>(at + 4, 0);
+    at += 8;
+    for (const auto& position : positions) {
+        store(at, PositionEntry{tickerIds().intern(position.ticker), position.quantity, position.value,
+                                position.cost_basis});
+        at += sizeof(PositionEntry);
+    }
+}
+
+}  // namespace
+
+bool binaryMayBlock(std::string_view frame) {
+    uint16_t type = frameType(frame.data());
+    return type == BUY || type == SELL;
+}
+
+void handleBinaryFrame(std::string_view frame, std::string& session, std::string& out) {
+    uint16_t type = frameType(frame.data());
+    uint64_t tag = frameTag(frame.data());
+    const char* body = frame.data() + HEADER_SIZE;
+    size_t body_size = frame.size() - HEADER_SIZE;
+    ScopedTimer timer(durationOf(type));
+
+    uint16_t status = OK;
+    switch (type) {
+        case LOGIN:
+            status = login(body, body_size, session);
+            break;
+        case SYMBOLS:
+        case QUOTES:
+            if (body_size != 0) {
+                status = BAD_FRAME;
+            } else {
+                type == SYMBOLS ? symbols(tag, out) : quotes(tag, out);
+                return;
+            }
+            break;
+        case BUY:
+        case SELL:
+            status = trade(type == BUY, body, body_size, session);
+            break;
+        case PORTFOLIO:
+            if (body_size != 0) {
+                status = BAD_FRAME;
+            } else if (session.empty()) {
+                status = NOT_LOGGED_IN;
+            } else {
+                portfolio(tag, session, out);
+                return;
+            }
+            break;
+        default:
+            status = UNKNOWN_TYPE;
+    }
+    appendStatus(out, frame, status);
+}
@@ -0,0 +1,17 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <string>
+#include <string_view>
+
+// Frames of the binary protocol (utils/binary_protocol.h). frame is one
+// complete request, header included.
+
+// BUY and SELL wait for the transaction log and belong on a worker
+bool binaryMayBlock(std::string_view frame);
+
+// Answer one request by appending its reply frame to out. session is the
+// connection's logged-in user ("" until LOGIN succeeds).
+void handleBinaryFrame(std::string_view frame, std::string& session, std::string& out);
+
+#endif
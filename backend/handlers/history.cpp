@@ -0,0 +1,139 @@
+#include "history.h"
+#include "../utils/transaction_index.h"
+#include "../utils/command_router.h"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+// How many rows CSV_BUYS and RECENT_SELLS return
+const size_t RECENT_COUNT = 3;
+// Largest page a HISTORY request may ask for
+const size_t MAX_HISTORY_PAGE = 100;
+
+namespace {
+
+std::string toJson(const std::vector<TransactionEntry>& entries) {
+    std::stringstream result;
+    result << "[";
+
+    bool first = true;
+    for (const auto& entry : entries) {
+        if (!first) result << ",";
+        first = false;
+
+        result << "{"
+               << "\"username\":\"" << entry.username << "\","
+               << "\"type\":\"" << entry.side << "\","
+               << "\"ticker\":\"" << entry.ticker << "\","
+               << "\"quantity\":" << entry.quantity << ","
+               << "\"price\":" << entry.price << ","
+               << "\"total\":" << entry.quantity * std::stod(entry.price) << ","
+               << "\"time\":" << entry.time_ms
+               << "}";
+    }
+
+    result << "]";
+    return result.str();
+}
+
+std::string recent(const std::string& username, const std::string& side) {
+    auto entries = transactionIndex().history(username, side, 0, RECENT_COUNT);
+    std::reverse(entries.begin(), entries.end());  // these lists have always been oldest first
+    return toJson(entries);
+}
+
+}  // namespace
+
+std::string getRecentBuys(const std::string& username) {
+    return recent(username, "BUY");
+}
+
+std::string getRecentSells(const std::string& username) {
+    return recent(username, "SELL");
+}
+
+std::string getHistory(const std::string& username, const std::string& side, size_t offset, size_t limit,
+                       int64_t from, int64_t to) {
+    return toJson(transactionIndex().history(username, side == "ALL" ? "" : side, offset,
+                                             std::min(limit, MAX_HISTORY_PAGE), from, to));
+}
+
+std::string getPnl(const std::string& username, int64_t from, int64_t to) {
+    std::stringstream result;
+    result << std::fixed << std::setprecision(2) << "[";
+    bool first = true;
+    for (const auto& p : transactionIndex().pnl(username, from, to)) {
+        if (!first) result << ",";
+        first = false;
+        result << "{"
+               << "\"ticker\":\"" << p.ticker << "\","
+               << "\"bought\":" << p.bought << ","
+               << "\"sold\":" << p.sold << ","
+               << "\"buyValue\":" << p.buy_value << ","
+               << "\"sellValue\":" << p.sell_value << ","
+               << "\"realized\":" << p.realized << ","
+               << "\"position\":" << p.position << ","
+               << "\"costBasis\":" << p.cost_basis
+               << "}";
+    }
+    result << "]";
+    return result.str();
+}
+
+std::string getVolume(int64_t from, int64_t to, const std::string& ticker) {
+    std::stringstream result;
+    result << std::fixed << std::setprecision(2) << "[";
+    bool first = true;
+    for (const auto& v : transactionIndex().volume(from, to, ticker)) {
+        if (!first) result << ",";
+        first = false;
+        result << "{"
+               << "\"ticker\":\"" << v.ticker << "\","
+               << "\"trades\":" << v.trades << ","
+               << "\"quantity\":" << v.quantity << ","
+               << "\"notional\":" << v.notional
+               << "}";
+    }
+    result << "]";
+    return result.str();
+}
+
+void registerHistoryCommands(CommandRouter& router) {
+    // CSV_BUYS and RECENT_SELLS have always taken the rest of the line as the name
+    router.add(Command::CSV_BUYS, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs& args, CommandContext&) {
+        std::string_view username;
+        args.rest(username);
+        return getRecentBuys(std::string(username));
+    });
+    router.add(Command::RECENT_SELLS, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs& args, CommandContext&) {
+        std::string_view username;
+        args.rest(username);
+        return getRecentSells(std::string(username));
+    });
+    router.add(Command::HISTORY, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs& args, CommandContext&) {
+        size_t fields = args.remaining();
+        std::string username, side;
+        size_t offset = 0, limit = 0;
+        int64_t from = 0, to = TransactionIndex::ALL_TIME;
+        bool valid = (fields == 4 || fields == 6) && args.next(username) && args.next(side) &&
+                     (side == "BUY" || side == "SELL" || side == "ALL") && args.next(offset) && args.next(limit);
+        valid = valid && (fields == 4 || (args.next(from) && args.next(to)));
+        return valid ? getHistory(username, side, offset, limit, from, to) : std::string("ERROR|Invalid format");
+    });
+    router.add(Command::PNL, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        size_t fields = args.remaining();
+        std::string username;
+        int64_t from = 0, to = TransactionIndex::ALL_TIME;
+        bool valid = (fields == 1 || fields == 3) && args.next(username) &&
+                     (fields == 1 || (args.next(from) && args.next(to)));
+        return valid ? getPnl(username, from, to) : std::string("ERROR|Invalid format");
+    });
+    router.add(Command::VOLUME, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        size_t fields = args.remaining();
+        int64_t from = 0, to = 0;
+        std::string ticker;
+        bool valid = (fields == 2 || fields == 3) && args.next(from) && args.next(to) &&
+                     (fields == 2 || args.next(ticker));
+        return valid ? getVolume(from, to, ticker) : std::string("ERROR|Invalid format");
+    });
+}
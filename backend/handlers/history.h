@@ -0,0 +1,28 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <string>
+#include <cstdint>
+
+class CommandRouter;
+
+// JSON arrays of a user's transactions, answered from the resident index
+std::string getRecentBuys(const std::string& username);   // last 3, oldest first
+std::string getRecentSells(const std::string& username);  // last 3, oldest first
+
+// One page of history, newest first; side is "BUY", "SELL" or "ALL".
+// from/to (ms since the epoch, inclusive) restrict it to a time range.
+std::string getHistory(const std::string& username, const std::string& side, size_t offset, size_t limit,
+                       int64_t from, int64_t to);
+
+// JSON reports over a time range: one user's realized P&L per ticker, and
+// traded volume per ticker (or of one ticker if given)
+std::string getPnl(const std::string& username, int64_t from, int64_t to);
+std::string getVolume(int64_t from, int64_t to, const std::string& ticker);
+
+// CSV_BUYS|username, RECENT_SELLS|username,
+// HISTORY|username|BUY|SELL|ALL|offset|limit[|from|to], PNL|username[|from|to]
+// and VOLUME|from|to[|ticker]
+void registerHistoryCommands(CommandRouter& router);
+
+#endif
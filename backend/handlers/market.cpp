@@ -1,18 +1,87 @@
 #include "market.h"
-#include "../utils/csv.h"
+#include "../utils/quote_table.h"
+#include "../utils/market_history.h"
+#include "../utils/command_router.h"
 #include <sstream>
+#include <iomanip>
 
-const std::string MARKET_FILE = "db/market.csv";
+// Most candles one CANDLES request returns (the oldest in the range)
+const size_t MAX_CANDLES = 5000;
 
 std::string getMarketData() {
-    std::ostringstream oss;
-    auto data = readCSV(MARKET_FILE);
+    // Serialized once per generation of the quote table
+    return quoteTable().snapshot()->marketData();
+}
 
-    for (const auto& row : data) {
-        if (row.size() >= 3) {
-            oss << row[0] << "," << row[1] << "," << row[2] << ";";
-        }
+std::string getCandles(const std::string& ticker, const std::string& interval, int64_t from, int64_t to) {
+    int64_t interval_ms = interval == "1s" ? 1000 : interval == "1m" ? 60 * 1000 : interval == "1h" ? 60 * 60 * 1000 : 0;
+    std::vector<Candle> candles;
+    if (!marketHistory().candles().candles(ticker, interval_ms, from, to, MAX_CANDLES, candles)) {
+        return "ERROR|Invalid interval";
+    }
+
+    std::stringstream result;
+    result << std::setprecision(10) << "[";
+    bool first = true;
+    for (const auto& c : candles) {
+        if (!first) result << ",";
+        first = false;
+        result << "{"
+               << "\"time\":" << c.start_ms << ","
+               << "\"open\":" << c.open << ","
+               << "\"high\":" << c.high << ","
+               << "\"low\":" << c.low << ","
+               << "\"close\":" << c.close << ","
+               << "\"volume\":" << c.volume
+               << "}";
     }
+    result << "]";
+    return result.str();
+}
+
+std::string marketSnapshotEvent() {
+    auto snapshot = quoteTable().snapshot();
+    return "id: " + std::to_string(snapshot->version) + "\n"
+           "event: snapshot\n"
+           "data: " + snapshot->marketData() + "\n\n";
+}
 
-    return "DATA|" + oss.str();
+std::string marketDeltaEvent(const MarketSnapshot& previous, const MarketSnapshot& next) {
+    std::string changed;
+    forEachChangedQuote(next, [&](const Quote& quote) {
+        const Quote* old = previous.find(quote.ticker);
+        if (old && old->price_text == quote.price_text && old->name == quote.name) return;
+        changed += quote.ticker + "," + quote.name + "," + quote.price_text + ";";
+    });
+
+    std::string removed;
+    for (const auto& quote : previous.quotes) {
+        if (next.incremental) break;  // a price update removes nothing
+        if (next.find(quote.ticker)) continue;
+        if (!removed.empty()) removed += ",";
+        removed += quote.ticker;
+    }
+
+    std::string id = "id: " + std::to_string(next.version) + "\n";
+    std::string events;
+    if (!changed.empty()) events += id + "event: delta\ndata: DATA|" + changed + "\n\n";
+    if (!removed.empty()) events += id + "event: remove\ndata: " + removed + "\n\n";
+    return events;
+}
+
+void registerMarketCommands(CommandRouter& router) {
+    router.add(Command::GET_MARKET, CommandRouter::NO_ARGUMENTS, false, [](CommandArgs&, CommandContext&) {
+        return getMarketData();
+    });
+    router.add(Command::STREAM_MARKET, CommandRouter::NO_ARGUMENTS, false, [](CommandArgs&, CommandContext&) {
+        return std::string("ERROR|Streaming unavailable, use GET_MARKET");
+    });
+    router.add(Command::CANDLES, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs& args, CommandContext&) {
+        std::string ticker, interval;
+        int64_t from = 0, to = 0;
+        if (args.remaining() != 4 || !args.next(ticker) || !args.next(interval) || !args.next(from) || !args.next(to)) {
+            return std::string("ERROR|Invalid format");
+        }
+        return getCandles(ticker, interval, from, to);
+    });
 }
@@ -2,7 +2,26 @@
 #define MARKET_H
 
 #include <string>
+#include <cstdint>
+
+struct MarketSnapshot;
+class CommandRouter;
 
 std::string getMarketData();
 
+// JSON array of OHLCV candles for one ticker; interval is "1s", "1m" or
+// "1h" and [from, to] (ms since the epoch) bounds the bucket start times.
+// "ERROR|..." for an unknown interval.
+std::string getCandles(const std::string& ticker, const std::string& interval, int64_t from, int64_t to);
+
+// Server-Sent Events for STREAM_MARKET. Event data uses the GET_MARKET
+// row format ("DATA|ticker,name,price;...") so clients parse it the same way.
+std::string marketSnapshotEvent();                          // every quote
+std::string marketDeltaEvent(const MarketSnapshot& previous,
+                             const MarketSnapshot& next);   // changes only, "" if none
+
+// GET_MARKET, STREAM_MARKET (taken over by the event loops; refused when
+// it reaches the router) and CANDLES|ticker|1s|1m|1h|from|to
+void registerMarketCommands(CommandRouter& router);
+
 #endif
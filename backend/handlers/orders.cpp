@@ -0,0 +1,265 @@
+#include "orders.h"
+#include "trade.h"
+#include "../utils/order_book.h"
+#include "../utils/quote_table.h"
+#include "../utils/transaction_manager.h"
+#include "../utils/metrics.h"
+#include "../utils/command_router.h"
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Book prices are integer ticks of one cent
+const double TICKS_PER_DOLLAR = 100;
+// Matcher threads; tickers are spread over them by hash
+const unsigned MAX_MATCHERS = 8;
+
+namespace {
+
+struct Outcome {
+    std::string response;
+    uint64_t last_seq = 0;  // of the last trade logged, 0 if none
+};
+
+// One thread owning the books of the tickers hashed to it, so matching
+// needs no locks. Requests are queued to it and answered through a future.
+class Matcher {
+public:
+    Matcher() : thread([this] { run(); }) {}
+
+    ~Matcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    Outcome call(std::function<Outcome(Matcher&)> request) {
+        std::packaged_task<Outcome()> task([this, &request] { return request(*this); });
+        auto result = task.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+        return result.get();
+    }
+
+    OrderBook& book(const std::string& ticker) { return books[ticker]; }
+
+    // The ticker's book if an order was ever placed for it; lookups that
+    // come from the client's ticker must not create books
+    OrderBook* findBook(const std::string& ticker) {
+        auto it = books.find(ticker);
+        return it == books.end() ? nullptr : &it->second;
+    }
+
+    uint32_t ownerId(const std::string& username) {
+        auto it = owner_ids.emplace(username, static_cast<uint32_t>(owners.size())).first;
+        if (it->second == owners.size()) owners.push_back(username);
+        return it->second;
+    }
+
+    bool owns(const std::string& username, const Order& order) const {
+        auto it = owner_ids.find(username);
+        return it != owner_ids.end() && it->second == order.owner;
+    }
+
+    const std::string& ownerName(uint32_t id) const { return owners[id]; }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::packaged_task<Outcome()>> tasks;
+    bool stopping = false;
+
+    // Touched only by the matcher thread
+    std::unordered_map<std::string, OrderBook> books;
+    std::vector<std::string> owners;
+    std::unordered_map<std::string, uint32_t> owner_ids;
+
+    std::thread thread;  // last, so it starts after the members above
+};
+
+Matcher& matcherFor(const std::string& ticker) {
+    static const std::vector<std::unique_ptr<Matcher>> matchers = [] {
+        unsigned count = std::min(MAX_MATCHERS, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::unique_ptr<Matcher>> result;
+        for (unsigned i = 0; i < count; ++i) result.push_back(std::make_unique<Matcher>());
+        return result;
+    }();
+    return *matchers[std::hash<std::string>{}(ticker) % matchers.size()];
+}
+
+// Dollars to ticks; false unless positive and a whole number of cents
+bool toTicks(double price, int64_t& ticks) {
+    double scaled = price * TICKS_PER_DOLLAR;
+    if (!(scaled >= 1) || scaled > 1e12) return false;
+    ticks = std::llround(scaled);
+    return std::fabs(scaled - ticks) < 1e-6;
+}
+
+// Limit prices must lie within this fraction of the last quote, which also
+// bounds how wide a book's price ladders can grow
+const double PRICE_BAND = 0.5;
+
+// "" if price is acceptable for ticker, else the error response
+std::string checkPrice(const std::string& ticker, double price) {
+    auto market = quoteTable().snapshot();
+    const Quote* quote = market->find(ticker);
+    if (!quote) return "ERROR|Unknown ticker";
+    if (std::fabs(price - quote->price) > quote->price * PRICE_BAND) return "ERROR|Price out of range";
+    return "";
+}
+
+// Match and rest one order; runs on the ticker's matcher thread
+Outcome place(Matcher& matcher, const std::string& username, OrderBook::Side side, const std::string& ticker,
+              int quantity, int64_t ticks) {
+    static const Counter fills("server_order_fills_total", "", "Matches between limit orders");
+    // Checked here, on the matcher thread, so the book never produces
+    // fills the log cannot record
+    if (!transactionManager().healthy()) return {"ERROR|Trade log unavailable"};
+    if (side == OrderBook::SELL && !reserveShares(username, ticker, quantity)) {
+        return {"ERROR|Insufficient shares"};
+    }
+
+    Outcome outcome;
+    auto result = matcher.book(ticker).add(matcher.ownerId(username), side, ticks, quantity, [&](const Fill& fill) {
+        const std::string& maker = matcher.ownerName(fill.maker_owner);
+        bool buying = fill.taker_side == OrderBook::BUY;
+        outcome.last_seq = settleFill(buying ? username : maker, buying ? maker : username, ticker, fill.quantity,
+                                      fill.price / TICKS_PER_DOLLAR);
+        fills.add();
+    });
+    // Fills consumed their part of a sell's reservation; free what was
+    // neither filled nor rested
+    int32_t dropped = quantity - result.filled - result.resting;
+    if (side == OrderBook::SELL && dropped > 0) releaseShares(username, ticker, dropped);
+    if (!result.accepted) {
+        outcome.response = "ERROR|Price out of range";
+        return outcome;
+    }
+    outcome.response = "OK|" + std::to_string(result.id) + "|" + std::to_string(result.filled) + "|" +
+                       std::to_string(result.resting);
+    return outcome;
+}
+
+// Take an order off the book and free what it reserved
+void remove(OrderBook& book, const std::string& username, const std::string& ticker, const Order& order) {
+    bool selling = order.side == OrderBook::SELL;
+    int32_t open = book.cancel(order.id);
+    if (selling) releaseShares(username, ticker, open);
+}
+
+// Wait for the trades an order produced to reach the disk
+std::string finish(const Outcome& outcome) {
+    if (outcome.last_seq != 0 && !transactionManager().waitDurable(outcome.last_seq)) {
+        return "ERROR|Trade log unavailable";
+    }
+    return outcome.response;
+}
+
+}  // namespace
+
+std::string placeLimitOrder(const std::string& username, const std::string& side, const std::string& ticker,
+                            int quantity, double price) {
+    int64_t ticks;
+    if ((side != "BUY" && side != "SELL") || quantity <= 0 || !toTicks(price, ticks) || !validTradeField(username)) {
+        return "ERROR|Invalid order";
+    }
+    std::string error = checkPrice(ticker, price);
+    if (!error.empty()) return error;
+    OrderBook::Side book_side = side == "BUY" ? OrderBook::BUY : OrderBook::SELL;
+    return finish(matcherFor(ticker).call([&](Matcher& matcher) {
+        return place(matcher, username, book_side, ticker, quantity, ticks);
+    }));
+}
+
+std::string cancelOrder(const std::string& username, const std::string& ticker, uint64_t id) {
+    return finish(matcherFor(ticker).call([&](Matcher& matcher) -> Outcome {
+        OrderBook* book = matcher.findBook(ticker);
+        const Order* order = book ? book->find(id) : nullptr;
+        if (!order || !matcher.owns(username, *order)) return {"ERROR|Unknown order"};
+        remove(*book, username, ticker, *order);
+        return {"OK|Cancelled"};
+    }));
+}
+
+std::string modifyOrder(const std::string& username, const std::string& ticker, uint64_t id, int quantity,
+                        double price) {
+    int64_t ticks;
+    if (quantity <= 0 || !toTicks(price, ticks)) return "ERROR|Invalid order";
+    std::string error = checkPrice(ticker, price);
+    if (!error.empty()) return error == "ERROR|Unknown ticker" ? "ERROR|Unknown order" : error;
+    return finish(matcherFor(ticker).call([&](Matcher& matcher) -> Outcome {
+        OrderBook* book = matcher.findBook(ticker);
+        const Order* order = book ? book->find(id) : nullptr;
+        if (!order || !matcher.owns(username, *order)) return {"ERROR|Unknown order"};
+        // Before touching the order: re-placing it could produce fills
+        if (!transactionManager().healthy()) return {"ERROR|Trade log unavailable"};
+
+        if (order->price == ticks && quantity <= order->quantity) {
+            int32_t freed = order->quantity - quantity;
+            if (order->side == OrderBook::SELL) releaseShares(username, ticker, freed);
+            book->reduce(id, quantity);
+            return {"OK|" + std::to_string(id) + "|0|" + std::to_string(quantity)};
+        }
+        auto side = static_cast<OrderBook::Side>(order->side);
+        remove(*book, username, ticker, *order);
+        return place(matcher, username, side, ticker, quantity, ticks);
+    }));
+}
+
+void registerOrderCommands(CommandRouter& router) {
+    router.add(Command::LIMIT, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        std::string username, side, ticker;
+        int quantity = 0;
+        double price = 0;
+        if (args.remaining() != 5 || !args.next(username) || !args.next(side) || !args.next(ticker) ||
+            !args.next(quantity) || !args.next(price)) {
+            return std::string("ERROR|Invalid format");
+        }
+        return placeLimitOrder(username, side, ticker, quantity, price);
+    });
+    router.add(Command::CANCEL, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        std::string username, ticker;
+        uint64_t id = 0;
+        if (args.remaining() != 3 || !args.next(username) || !args.next(ticker) || !args.next(id)) {
+            return std::string("ERROR|Invalid format");
+        }
+        return cancelOrder(username, ticker, id);
+    });
+    router.add(Command::MODIFY, CommandRouter::WITH_ARGUMENTS, true, [](CommandArgs& args, CommandContext&) {
+        std::string username, ticker;
+        uint64_t id = 0;
+        int quantity = 0;
+        double price = 0;
+        if (args.remaining() != 5 || !args.next(username) || !args.next(ticker) || !args.next(id) ||
+            !args.next(quantity) || !args.next(price)) {
+            return std::string("ERROR|Invalid format");
+        }
+        return modifyOrder(username, ticker, id, quantity, price);
+    });
+}
@@ -0,0 +1,31 @@
+#ifndef ORDERS_H
+#define ORDERS_H
+
+#include <string>
+#include <cstdint>
+
+class CommandRouter;
+
+// Limit orders, matched per ticker with price-time priority against the
+// other users' resting orders. Prices are in dollars to the cent and must
+// be within 50% of the ticker's last quote. Each
+// returns the response text: "OK|id|filled|resting" (id 0 when nothing
+// rests), "OK|Cancelled" or "ERROR|reason".
+//
+// Resting orders live in memory only and are gone after a restart; the
+// trades they produce are logged like BUY and SELL.
+std::string placeLimitOrder(const std::string& username, const std::string& side, const std::string& ticker,
+                            int quantity, double price);
+std::string cancelOrder(const std::string& username, const std::string& ticker, uint64_t id);
+
+// Change an order's quantity and price. Reducing the quantity at the same
+// price keeps its place in the queue; anything else cancels it and places
+// a new order (with a new id).
+std::string modifyOrder(const std::string& username, const std::string& ticker, uint64_t id, int quantity,
+                        double price);
+
+// LIMIT|username|BUY|SELL|ticker|quantity|price, CANCEL|username|ticker|id
+// and MODIFY|username|ticker|id|quantity|price
+void registerOrderCommands(CommandRouter& router);
+
+#endif
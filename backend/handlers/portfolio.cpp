@@ -1,18 +1,27 @@
 #include "portfolio.h"
-#include "../utils/csv.h"
+#include "auth.h"
+#include "../utils/valuation.h"
+#include "../utils/command_router.h"
+#include "../utils/http_parser.h"
 #include <sstream>
-
-const std::string HOLDINGS_FILE = "db/holdings.csv";
+#include <iomanip>
 
 std::string getPortfolio(const std::string& username) {
     std::ostringstream oss;
-    auto data = readCSV(HOLDINGS_FILE);
+    oss << std::fixed << std::setprecision(2);
 
-    for (const auto& row : data) {
-        if (row.size() >= 3 && row[0] == username) {
-            oss << row[1] << "," << row[2] << ";";  // ticker, quantity
-        }
+    for (const auto& position : valuationEngine().portfolio(username)) {
+        // ticker, quantity, market value, cost basis, unrealized P&L
+        oss << position.ticker << "," << position.quantity << "," << position.value << ","
+            << position.cost_basis << "," << position.unrealized() << ";";
     }
 
     return "DATA|" + oss.str();
 }
+
+void registerPortfolioCommands(CommandRouter& router) {
+    router.add(Command::PORTFOLIO, CommandRouter::WITH_ARGUMENTS, false, [](CommandArgs&, CommandContext& context) {
+        std::string user = sessionUser(context.request.cookie("sessionId"));
+        return user.empty() ? std::string("ERROR|Not authenticated") : getPortfolio(user);
+    });
+}
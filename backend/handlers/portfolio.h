@@ -3,6 +3,11 @@
 
 #include <string>
 
+class CommandRouter;
+
 std::string getPortfolio(const std::string& username);
 
+// PORTFOLIO|username, answered for the user of the session cookie
+void registerPortfolioCommands(CommandRouter& router);
+
 #endif
@@ -1,69 +1,187 @@
 #include "trade.h"
-#include "../utils/csv.h"
+#include "../utils/holdings_store.h"
+#include "../utils/quote_table.h"
+#include "../utils/transaction_manager.h"
+#include "../utils/valuation.h"
+#include "../concurrency_managers.h"
+#include "../utils/metrics.h"
+#include "../utils/command_router.h"
 #include <vector>
 #include <string>
 #include <mutex>
-#include <fstream>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <optional>
 
-const std::string MARKET_FILE = "db/market.csv";
-const std::string HOLDINGS_FILE = "db/holdings.csv";
-const std::string TRANSACTIONS_FILE = "db/transactions.csv";
+// One user's trades run one at a time; different users trade in parallel
+StripedMutex<> account_locks;
+const LatencyHistogram account_lock_wait("server_lock_wait_seconds", "lock=\"account\"",
+                                         "Time spent waiting to acquire a lock");
 
-std::mutex trade_mutex;
+// Shares held for resting sell orders, keyed by "user|ticker"; each map is
+// guarded by the account lock stripe of its users
+std::array<std::unordered_map<std::string, int>, 64> reserved_shares;
+
+std::unordered_map<std::string, int>& reservationsOf(const std::string& username) {
+    return reserved_shares[StripedMutex<>::stripeOf(username)];
+}
+
+int reservedShares(const std::string& username, const std::string& ticker) {
+    auto& reserved = reservationsOf(username);
+    auto it = reserved.find(username + "|" + ticker);
+    return it == reserved.end() ? 0 : it->second;
+}
+
+void adjustReserved(const std::string& username, const std::string& ticker, int delta) {
+    auto& reserved = reservationsOf(username);
+    auto it = reserved.emplace(username + "|" + ticker, 0).first;
+    it->second = std::max(0, it->second + delta);
+    if (it->second == 0) reserved.erase(it);
+}
 
 float getPrice(const std::string& ticker) {
-    auto market = readCSV(MARKET_FILE);
-    for (auto& row : market) {
-        if (row.size() >= 3 && row[0] == ticker) {
-            return std::stof(row[2]);
-        }
-    }
-    return -1.0f;
+    auto market = quoteTable().snapshot();
+    const Quote* quote = market->find(ticker);
+    return quote ? static_cast<float>(quote->price) : -1.0f;
 }
 
-bool buyStock(const std::string& username, const std::string& ticker, int quantity) {
-    std::lock_guard<std::mutex> lock(trade_mutex);
-    float price = getPrice(ticker);
-    if (price <= 0) return false;
+// A trade is checked and applied to the holdings store under its account's
+// lock, which also fixes its place in the log relative to that account's
+// other trades; the wait for the disk flush happens after the lock is
+// released so concurrent trades share one fsync.
+//
+// Once the log has failed, trades are refused before they change anything.
+// The trades whose flush failed were applied already; they are reported as
+// failed and are not rolled back in memory, since later trades in the same
+// batch may build on them. Nothing of them reaches the disk, so the state
+// after a restart is that of the log.
 
-    auto holdings = readCSV(HOLDINGS_FILE);
-    bool found = false;
+// Apply one trade whose account lock is held; returns its log record, or
+// nothing if the log is down, the price is unknown or the shares are not
+// there to sell
+std::optional<TradeRecord> applyLocked(const std::string& username, bool buy, const std::string& ticker,
+                                       int quantity) {
+    if (!transactionManager().healthy()) return std::nullopt;
+    if (!validTradeField(username) || !validTradeField(ticker)) return std::nullopt;
+    float price = getPrice(ticker);
+    if (price <= 0) return std::nullopt;
 
-    for (auto& row : holdings) {
-        if (row.size() >= 3 && row[0] == username && row[1] == ticker) {
-            int currentQty = std::stoi(row[2]);
-            row[2] = std::to_string(currentQty + quantity);
-            found = true;
-            break;
-        }
+    auto& holdings = holdingsStore();
+    int newQty;
+    if (buy) {
+        newQty = holdings.getQuantity(username, ticker).value_or(0) + quantity;
+    } else {
+        auto currentQty = holdings.getQuantity(username, ticker);
+        if (!currentQty || *currentQty - reservedShares(username, ticker) < quantity) return std::nullopt;
+        newQty = *currentQty - quantity;
     }
+    holdings.setQuantity(username, ticker, newQty);
+    valuationEngine().onTrade(username, ticker, buy, quantity, price, newQty);
+    return TradeRecord{0, username, buy ? "BUY" : "SELL", ticker, quantity, std::to_string(price), newQty};
+}
 
-    if (!found) {
-        holdings.push_back({username, ticker, std::to_string(quantity)});
+bool trade(const std::string& username, bool buy, const std::string& ticker, int quantity) {
+    uint64_t seq;
+    {
+        auto lock = lockTimed(account_locks.forKey(username), account_lock_wait);
+        auto record = applyLocked(username, buy, ticker, quantity);
+        if (!record) return false;
+        seq = transactionManager().append(std::move(*record));
     }
+    return transactionManager().waitDurable(seq);
+}
 
-    writeCSV(HOLDINGS_FILE, holdings);
-    appendCSV(TRANSACTIONS_FILE, {username, "BUY", ticker, std::to_string(quantity), std::to_string(price)});
-    return true;
+bool buyStock(const std::string& username, const std::string& ticker, int quantity) {
+    return trade(username, true, ticker, quantity);
 }
 
 bool sellStock(const std::string& username, const std::string& ticker, int quantity) {
-    std::lock_guard<std::mutex> lock(trade_mutex);
-    float price = getPrice(ticker);
-    if (price <= 0) return false;
-
-    auto holdings = readCSV(HOLDINGS_FILE);
-    for (auto& row : holdings) {
-        if (row.size() >= 3 && row[0] == username && row[1] == ticker) {
-            int currentQty = std::stoi(row[2]);
-            if (currentQty < quantity) return false;
-
-            row[2] = std::to_string(currentQty - quantity);
-            writeCSV(HOLDINGS_FILE, holdings);
-            appendCSV(TRANSACTIONS_FILE, {username, "SELL", ticker, std::to_string(quantity), std::to_string(price)});
-            return true;
+    return trade(username, false, ticker, quantity);
+}
+
+// Every account stripe the list touches is locked once, in stripe order,
+// and the records are queued together so one flush makes them durable
+std::vector<bool> applyTrades(const std::vector<TradeOrder>& trades) {
+    std::vector<bool> applied(trades.size(), false);
+    std::vector<size_t> stripes;
+    for (const auto& order : trades) stripes.push_back(StripedMutex<>::stripeOf(order.username));
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+
+    uint64_t seq;
+    {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(stripes.size());
+        for (size_t stripe : stripes) locks.push_back(lockTimed(account_locks.stripe(stripe), account_lock_wait));
+
+        std::vector<TradeRecord> records;
+        for (size_t i = 0; i < trades.size(); ++i) {
+            const TradeOrder& order = trades[i];
+            auto record = applyLocked(order.username, order.buy, order.ticker, order.quantity);
+            if (!record) continue;
+            records.push_back(std::move(*record));
+            applied[i] = true;
         }
+        seq = transactionManager().append(std::move(records));
     }
+    if (seq != 0 && !transactionManager().waitDurable(seq)) applied.assign(trades.size(), false);
+    return applied;
+}
 
-    return false;
+bool reserveShares(const std::string& username, const std::string& ticker, int quantity) {
+    auto lock = lockTimed(account_locks.forKey(username), account_lock_wait);
+    int held = holdingsStore().getQuantity(username, ticker).value_or(0);
+    if (held - reservedShares(username, ticker) < quantity) return false;
+    adjustReserved(username, ticker, quantity);
+    return true;
+}
+
+void releaseShares(const std::string& username, const std::string& ticker, int quantity) {
+    auto lock = lockTimed(account_locks.forKey(username), account_lock_wait);
+    adjustReserved(username, ticker, -quantity);
+}
+
+// Both accounts are locked, in stripe order so two fills between the same
+// users in opposite directions cannot deadlock
+uint64_t settleFill(const std::string& buyer, const std::string& seller, const std::string& ticker, int quantity,
+                    double price) {
+    size_t first = StripedMutex<>::stripeOf(buyer);
+    size_t second = StripedMutex<>::stripeOf(seller);
+    if (first > second) std::swap(first, second);
+    auto lock = lockTimed(account_locks.stripe(first), account_lock_wait);
+    std::unique_lock<std::mutex> other;
+    if (second != first) other = lockTimed(account_locks.stripe(second), account_lock_wait);
+
+    auto& holdings = holdingsStore();
+    std::string text = std::to_string(price);
+    int sellerQty = holdings.getQuantity(seller, ticker).value_or(0) - quantity;
+    holdings.setQuantity(seller, ticker, sellerQty);
+    adjustReserved(seller, ticker, -quantity);
+    valuationEngine().onTrade(seller, ticker, false, quantity, price, sellerQty);
+    transactionManager().append({0, seller, "SELL", ticker, quantity, text, sellerQty});
+
+    int buyerQty = holdings.getQuantity(buyer, ticker).value_or(0) + quantity;
+    holdings.setQuantity(buyer, ticker, buyerQty);
+    valuationEngine().onTrade(buyer, ticker, true, quantity, price, buyerQty);
+    return transactionManager().append({0, buyer, "BUY", ticker, quantity, text, buyerQty});
+}
+
+bool parseTradeOrder(CommandArgs& args, bool buy, TradeOrder& order) {
+    order.buy = buy;
+    return args.remaining() == 3 && args.next(order.username) && args.next(order.ticker) && args.next(order.quantity) &&
+           validTradeField(order.username) && validTradeField(order.ticker);
+}
+
+void registerTradeCommands(CommandRouter& router) {
+    for (bool buy : {true, false}) {
+        router.add(buy ? Command::BUY : Command::SELL, CommandRouter::WITH_ARGUMENTS, true,
+                   [buy](CommandArgs& args, CommandContext&) {
+            TradeOrder order;
+            if (!parseTradeOrder(args, buy, order)) return std::string("ERROR|Invalid format");
+            bool done = buy ? buyStock(order.username, order.ticker, order.quantity)
+                            : sellStock(order.username, order.ticker, order.quantity);
+            return std::string(done ? "OK|Trade completed" : buy ? "ERROR|Buy failed" : "ERROR|Sell failed");
+        });
+    }
 }
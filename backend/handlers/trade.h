@@ -2,8 +2,40 @@
 #define TRADE_H
 
 #include <string>
+#include <vector>
+
+class CommandRouter;
 
 bool buyStock(const std::string& username, const std::string& ticker, int quantity);
 bool sellStock(const std::string& username, const std::string& ticker, int quantity);
 
+struct TradeOrder {
+    std::string username;
+    bool buy = true;
+    std::string ticker;
+    int quantity = 0;
+};
+
+// Apply a list of BUY/SELL orders in order under a single acquisition of
+// their accounts' locks and wait once for the log flush that holds them
+// all. Each entry of the result says whether that order went through.
+std::vector<bool> applyTrades(const std::vector<TradeOrder>& trades);
+
+// Read "username|ticker|quantity", the arguments of BUY and SELL
+class CommandArgs;
+bool parseTradeOrder(CommandArgs& args, bool buy, TradeOrder& order);
+
+// BUY|username|ticker|quantity and SELL|username|ticker|quantity
+void registerTradeCommands(CommandRouter& router);
+
+// Shares set aside for resting sell orders; SELL cannot spend them
+bool reserveShares(const std::string& username, const std::string& ticker, int quantity);
+void releaseShares(const std::string& username, const std::string& ticker, int quantity);
+
+// Apply one order-book match: move shares from seller to buyer at price,
+// consuming the seller's reservation, and log both sides. Returns the seq
+// of the last record (wait on it with transactionManager().waitDurable).
+uint64_t settleFill(const std::string& buyer, const std::string& seller, const std::string& ticker, int quantity,
+                    double price);
+
 #endif
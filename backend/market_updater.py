@@ -3,8 +3,10 @@ import requests
 import csv
 import time
 import os
+import tempfile
 from pathlib import Path
 import logging
+import socket
 
 # Set up logging
 logging.basicConfig(
@@ -27,6 +29,21 @@ symbols = ["AAPL", "MSFT", "GOOGL", "AMZN", "TSLA"]
 # Path to market.csv - adjust according to your directory structure
 MARKET_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "db/market.csv")
 
+# When the server runs a UDP feed source (MARKET_FEED=udp:<port>), set
+# MARKET_FEED_UDP=127.0.0.1:<port> to push each quote the moment it is
+# fetched instead of waiting for the end-of-cycle rewrite of market.csv
+FEED_ADDRESS = os.environ.get("MARKET_FEED_UDP")
+
+def push_quote(symbol, price):
+    if not FEED_ADDRESS:
+        return
+    host, port = FEED_ADDRESS.rsplit(":", 1)
+    try:
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+            sock.sendto(f"{symbol},{price}\n".encode(), (host, int(port)))
+    except OSError as e:
+        logger.warning(f"Could not push {symbol} to the feed: {e}")
+
 def fetch_stock_data(symbol):
     url = f"https://www.alphavantage.co/query?function=GLOBAL_QUOTE&symbol={symbol}&apikey={API_KEY}"
     
@@ -67,6 +84,30 @@ def fetch_stock_data(symbol):
         logger.error(f"Exception fetching {symbol}: {e}")
         return None
 
+def write_atomically(path, rows):
+    # Write a temp file next to the target, fsync it and rename it over the
+    # target, so the server (which maps the file) only ever sees a complete
+    # generation and a crash leaves either the old or the new prices
+    directory = os.path.dirname(path)
+    fd, tmp_path = tempfile.mkstemp(prefix=".market.", suffix=".tmp", dir=directory)
+    try:
+        with os.fdopen(fd, 'w', newline='') as file:
+            writer = csv.writer(file)
+            writer.writerows(rows)
+            file.flush()
+            os.fsync(file.fileno())
+        os.chmod(tmp_path, 0o644)
+        os.replace(tmp_path, path)
+    except BaseException:
+        if os.path.exists(tmp_path):
+            os.unlink(tmp_path)
+        raise
+    dir_fd = os.open(directory, os.O_RDONLY)
+    try:
+        os.fsync(dir_fd)
+    finally:
+        os.close(dir_fd)
+
 def update_market_csv():
     logger.info(f"Starting market data update")
     
@@ -93,6 +134,7 @@ def update_market_csv():
         if result:
             symbol, name, price = result
             updated_data.append([symbol, name, str(price)])
+            push_quote(symbol, price)
             success_count += 1
         else:
             # Use existing data for this symbol if available
@@ -106,9 +148,7 @@ def update_market_csv():
     # Write updated data to CSV
     if updated_data:
         try:
-            with open(MARKET_FILE, 'w', newline='') as file:
-                writer = csv.writer(file)
-                writer.writerows(updated_data)
+            write_atomically(MARKET_FILE, updated_data)
             logger.info(f"Successfully updated market.csv with {len(updated_data)} stocks ({success_count} fresh updates)")
         except Exception as e:
             logger.error(f"Error writing to market.csv: {e}")
@@ -1,5 +1,4 @@
 #include "server.h"
-#include <iostream>
 #include <thread>
 
 #ifdef _WIN32
@@ -25,14 +24,30 @@
     // UNIX/Linux/macOS headers
     #include <netinet/in.h>
     #include <unistd.h>
+    #include <sys/resource.h>
 #endif
 
 #include <cstring>
+#include <cstdlib>
 #include <sstream>
 #include "handlers/auth.h"
+#include "handlers/binary.h"
 #include "handlers/market.h"
 #include "handlers/trade.h"
 #include "handlers/portfolio.h"
+#include "handlers/history.h"
+#include "handlers/orders.h"
+#include "utils/holdings_store.h"
+#include "utils/transaction_manager.h"
+#include "utils/transaction_index.h"
+#include "utils/valuation.h"
+#include "utils/quote_table.h"
+#include "utils/market_feed.h"
+#include "utils/market_history.h"
+#include "utils/user_directory.h"
+#include "utils/snapshot.h"
+#include "utils/metrics.h"
+#include "utils/logger.h"
 #include <vector>
 #include <ctime>
 #include <iomanip>
@@ -44,153 +59,78 @@
 #include <queue>
 #include <functional>
 #include <memory>
+#include <algorithm>
 
-static std::unordered_map<std::string, std::string> sessions;
-static std::mutex sessions_mutex;
-
-// Define Transaction structure
-struct Transaction {
-    std::string username;
-    std::string ticker;
-    std::string type;  // "BUY" or "SELL"
-    int quantity;
-    double price;
-    std::string date;
-};
-
-// Vector to store all transactions
-static std::vector<Transaction> transactions;
-
-//getting last 3 sells
-std::string getRecentSellsFromCSV(const std::string& username, const std::string& path = "db/transactions.csv") {
-    std::ifstream file(path);
-    std::string line;
-    std::vector<std::string> matchingLines;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string user, type, ticker, quantityStr, priceStr;
-
-        std::getline(ss, user, ',');
-        std::getline(ss, type, ',');
-        std::getline(ss, ticker, ',');
-        std::getline(ss, quantityStr, ',');
-        std::getline(ss, priceStr, ',');
-
-        if (user == username && type == "SELL") {
-            matchingLines.push_back(line);
-        }
-    }
-
-    // Only keep the last 3
-    int start = std::max(0, (int)matchingLines.size() - 3);
-    std::stringstream result;
-    result << "[";
-
-    bool first = true;
-    for (int i = start; i < matchingLines.size(); ++i) {
-        std::stringstream ss(matchingLines[i]);
-        std::string user, type, ticker, quantityStr, priceStr;
-        std::getline(ss, user, ',');
-        std::getline(ss, type, ',');
-        std::getline(ss, ticker, ',');
-        std::getline(ss, quantityStr, ',');
-        std::getline(ss, priceStr, ',');
-
-        if (!first) result << ",";
-        first = false;
-
-        result << "{"
-               << "\"username\":\"" << user << "\","
-               << "\"type\":\"" << type << "\","
-               << "\"ticker\":\"" << ticker << "\","
-               << "\"quantity\":" << quantityStr << ","
-               << "\"price\":" << priceStr << ","
-               << "\"total\":" << std::stod(quantityStr) * std::stod(priceStr)
-               << "}";
-    }
-
-    result << "]";
-    return result.str();
+// Last socket error, for log messages
+static int socketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
 }
 
-
-//getting last 3 buys
-std::string getLast3BuysFromCSV(const std::string& username, const std::string& path = "db/transactions.csv") {
-    std::ifstream file(path);
-    std::string line;
-    std::vector<std::string> matchingLines;
-
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string user, type, ticker, quantityStr, priceStr;
-
-        std::getline(ss, user, ',');
-        std::getline(ss, type, ',');
-        std::getline(ss, ticker, ',');
-        std::getline(ss, quantityStr, ',');
-        std::getline(ss, priceStr, ',');
-
-        if (user == username && type == "BUY") {
-            matchingLines.push_back(line);
-        }
-    }
-
-    // Only keep the last 3
-    int start = std::max(0, (int)matchingLines.size() - 3);
-    std::stringstream result;
-    result << "[";
-
-    bool first = true;
-    for (int i = start; i < matchingLines.size(); ++i) {
-        std::stringstream ss(matchingLines[i]);
-        std::string user, type, ticker, quantityStr, priceStr;
-        std::getline(ss, user, ',');
-        std::getline(ss, type, ',');
-        std::getline(ss, ticker, ',');
-        std::getline(ss, quantityStr, ',');
-        std::getline(ss, priceStr, ',');
-
-        if (!first) result << ",";
-        first = false;
-
-        result << "{"
-               << "\"username\":\"" << user << "\","
-               << "\"type\":\"" << type << "\","
-               << "\"ticker\":\"" << ticker << "\","
-               << "\"quantity\":" << quantityStr << ","
-               << "\"price\":" << priceStr << ","
-               << "\"total\":" << std::stod(quantityStr) * std::stod(priceStr)
-               << "}";
-    }
-
-    result << "]";
-    return result.str();
+Server::Server(int port) : port(port) {  //this defines the constructor
+    // Each handler module registers its own commands
+    registerAuthCommands(router);
+    registerMarketCommands(router);
+    registerTradeCommands(router);
+    registerPortfolioCommands(router);
+    registerHistoryCommands(router);
+    registerOrderCommands(router);
+    router.add(Command::METRICS, CommandRouter::NO_ARGUMENTS, false, [](CommandArgs&, CommandContext&) {
+        return renderMetrics();
+    });
+    router.add(Command::BATCH, CommandRouter::WITH_ARGUMENTS, true,
+               [this](CommandArgs& args, CommandContext& context) {
+        std::string_view body;
+        args.rest(body);
+        return handleBatch(body, context.request);
+    });
 }
 
-
-Server::Server(int port) : port(port) {}  //this defines the constructor
-
 void Server::start() {
 #ifdef _WIN32
     // Initialize Winsock
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        std::cerr << "Failed to initialize Winsock: " << WSAGetLastError() << std::endl;
+        LOG_ERROR("Failed to initialize Winsock: " << WSAGetLastError());
         return;
     }
 #endif
 
+    // Nothing is being rewritten yet, so any temp file is from a crash
+    if (size_t stale = removeStaleTemporaries("db")) {
+        LOG_WARN("Removed " << stale << " temporary files left in db/ by an earlier run");
+    }
+
+    // Load resident data before accepting clients
+    userDirectory();
+    holdingsStore();
+    transactionManager();  // replays db/trades.wal
+    valuationEngine();     // values positions from holdings, history and prices
+    marketHistory();       // rebuilds candles from db/ticks/ and the trade store
+    quoteTable().watch();  // reloads prices when market.csv is rewritten
+
+    // In-process market data feed, e.g. MARKET_FEED=replay:db/feed.csv:10,udp:9100
+    if (const char* feeds = std::getenv("MARKET_FEED")) {
+        std::stringstream list(feeds);
+        std::string spec;
+        while (std::getline(list, spec, ',')) {
+            if (!spec.empty()) marketFeed().addSource(spec);
+        }
+        marketFeed().start();
+    }
+
+#ifdef __linux__
+    runEventLoops();
+    return;
+#endif
+
     // Create server socket
     server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
-        std::cerr << "Socket creation failed: " << 
-#ifdef _WIN32
-            WSAGetLastError()
-#else
-            errno
-#endif
-        << std::endl;
+        LOG_ERROR("Socket creation failed: " << socketError());
         return;
     }
 
@@ -203,13 +143,7 @@ void Server::start() {
         &opt, 
 #endif
         sizeof(opt)) < 0) {
-        std::cerr << "setsockopt failed: " << 
-#ifdef _WIN32
-            WSAGetLastError()
-#else
-            errno
-#endif
-        << std::endl;
+        LOG_ERROR("setsockopt failed: " << socketError());
         close(server_fd);
         return;
     }
@@ -221,31 +155,19 @@ void Server::start() {
     address.sin_port = htons(port);
 
     if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        std::cerr << "Bind failed: Port " << port << ", Error: " << 
-#ifdef _WIN32
-            WSAGetLastError()
-#else
-            errno
-#endif
-        << std::endl;
+        LOG_ERROR("Bind failed: Port " << port << ", Error: " << socketError());
         close(server_fd);
         return;
     }
 
     // Listen
     if (listen(server_fd, SOMAXCONN) < 0) {
-        std::cerr << "Listen failed: " << 
-#ifdef _WIN32
-            WSAGetLastError()
-#else
-            errno
-#endif
-        << std::endl;
+        LOG_ERROR("Listen failed: " << socketError());
         close(server_fd);
         return;
     }
 
-    std::cout << "Server listening on port " << port << std::endl;
+    LOG_INFO("Server listening on port " << port);
 
     // Initialize thread pool and connection manager
     thread_pool = std::make_unique<ThreadPool>(10);  // 10 worker threads
@@ -265,34 +187,31 @@ void Server::start() {
             &client_address_len);
         
         if (client_socket < 0) {
-            std::cerr << "Accept failed: " << 
-#ifdef _WIN32
-                WSAGetLastError()
-#else
-                errno
-#endif
-            << std::endl;
+            LOG_ERROR("Accept failed: " << socketError());
             continue;
         }
 
-        // Check if we can accept more connections
-        if (!connection_manager->acquire_connection()) {
-            std::cerr << "Max connections reached. Rejecting client." << std::endl;
+        // Turn the client away at once if we are full
+        uint32_t client_ip = ntohl(client_address.sin_addr.s_addr);
+        if (!connection_manager->acquire_connection(client_ip)) {
+            LOG_SAMPLED(LOG_LEVEL_WARN, 100, "Max connections reached. Rejecting client.");
+            std::string rejection = httpErrorResponse(503);
+            send(client_socket, rejection.c_str(), rejection.size(), 0);
             close(client_socket);
             continue;
         }
 
         // Enqueue client handling task
-        thread_pool->enqueue([this, client_socket]() {
+        thread_pool->enqueue([this, client_socket, client_ip]() {
             try {
                 handleClient(client_socket);
             }
             catch (const std::exception& e) {
-                std::cerr << "Error handling client: " << e.what() << std::endl;
+                LOG_ERROR("Error handling client: " << e.what());
             }
             
             // Always release the connection
-            connection_manager->release_connection();
+            connection_manager->release_connection(client_ip);
             close(client_socket);
         });
     }
@@ -302,34 +221,8 @@ void Server::start() {
     WSACleanup();
 #endif
 }
-// Parse an HTTP request to extract the command
-std::string Server::parseHttpRequest(const std::string& request) {
-    // Check if this is a GET request
-    if (request.substr(0, 3) == "GET") {
-        // Format: GET /COMMAND HTTP/1.1
-        size_t start = request.find('/') + 1;
-        size_t end = request.find(' ', start);
-        if (start != std::string::npos && end != std::string::npos) {
-            return request.substr(start, end - start);
-        }
-    }
-    // Check if this is a POST request with a body
-    else if (request.substr(0, 4) == "POST") {
-        // Look for the empty line separating headers from body
-        size_t headerEnd = request.find("\r\n\r\n");
-        if (headerEnd != std::string::npos) {
-            // Return the body content
-            return request.substr(headerEnd + 4);
-        }
-    }
-    
-    // If we can't parse it as HTTP, return it as is
-    // (for backward compatibility with direct TCP commands)
-    return request;
-}
-
 // Create an HTTP response
-std::string Server::createHttpResponse(const std::string& content, bool success, const std::string& sessionId) {
+std::string Server::createHttpResponse(const std::string& content, bool success, const std::string& sessionId, bool keepAlive) {
     std::stringstream response;
     response << "HTTP/1.1 " << (success ? "200 OK" : "400 Bad Request") << "\r\n";
     response << "Content-Type: text/plain\r\n";
@@ -340,6 +233,7 @@ std::string Server::createHttpResponse(const std::string& content, bool success,
 response << "Access-Control-Allow-Credentials: true\r\n";
     response << "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
     response << "Access-Control-Allow-Headers: Content-Type\r\n";
+    response << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n";
     response << "Content-Length: " << content.length() << "\r\n";
     response << "\r\n"; // End of headers
     response << content;
@@ -349,149 +243,227 @@ response << "Access-Control-Allow-Credentials: true\r\n";
 
 
 
-std::string getSessionIdFromRequest(const std::string& request) {
-    std::string cookieToken = "Cookie:";
-    size_t pos = request.find(cookieToken);
-    if (pos != std::string::npos) {
-        size_t end = request.find("\r\n", pos);
-        std::string cookieLine = request.substr(pos, end - pos);
-        size_t sPos = cookieLine.find("sessionId=");
-        if (sPos != std::string::npos) {
-            sPos += std::string("sessionId=").length();
-            size_t semicolon = cookieLine.find(";", sPos);
-            if (semicolon == std::string::npos)
-                return cookieLine.substr(sPos);
-            else
-                return cookieLine.substr(sPos, semicolon - sPos);
-        }
-    }
-    return "";
+// Response head for a Server-Sent Events stream; the body never ends
+std::string Server::createStreamResponse() {
+    std::stringstream response;
+    response << "HTTP/1.1 200 OK\r\n";
+    response << "Content-Type: text/event-stream\r\n";
+    response << "Cache-Control: no-cache\r\n";
+    response << "Access-Control-Allow-Origin: http://localhost:8080\r\n";
+    response << "Access-Control-Allow-Credentials: true\r\n";
+    response << "Connection: keep-alive\r\n";
+    response << "\r\n";
+    response << "retry: 2000\n\n";  // reconnect delay for EventSource
+    return response.str();
 }
 
-
+// Blocking path used where epoll is unavailable: one request per socket
 void Server::handleClient(int clientSocket) {
-    char buffer[4096] = {0};
-    read(clientSocket, buffer, 4096);
-    std::string requestData(buffer);
-    
-    // Extract command from HTTP request if present
-    std::string command = parseHttpRequest(requestData);
-    std::cout << "Received command: " << command << std::endl;
-    
-    std::string result;
-    bool success = true;
+    HttpParser parser(http_limits);
+    std::string requestData;
+    char buffer[4096];
+    HttpParser::Status status = HttpParser::Status::Incomplete;
+
+    while (status == HttpParser::Status::Incomplete) {
+        ssize_t n = read(clientSocket, buffer, sizeof(buffer));
+        if (n <= 0) return;
+        requestData.append(buffer, n);
+        status = parser.parse(requestData);
+    }
 
-    // Process the command
-if (command.rfind("LOGIN|", 0) == 0) {
-    std::istringstream iss(command);
-    std::string action, username, password;
-    std::getline(iss, action, '|');
-    std::getline(iss, username, '|');
-    std::getline(iss, password);
-    
-    if (!username.empty() && !password.empty()) {
-        std::string sessionId;  // To hold our generated session ID
-        if (loginUser(username, password)) {
-            // Generate a simple session ID (for demo purposes only)
-            sessionId = "session_" + username + "_" + std::to_string(std::time(nullptr));
-            {
-                std::lock_guard<std::mutex> lock(sessions_mutex);
-                sessions[sessionId] = username;
-            }
-            // Return the username as part of the response.
-            // The response format will be: "OK|Logged in|<username>"
-            result = "OK|Logged in|" + username;
-            success = true;
-            std::string response = createHttpResponse(result, success, sessionId);
-            send(clientSocket, response.c_str(), response.size(), 0);
-            close(clientSocket);
+    std::string response = status == HttpParser::Status::Complete
+        ? handleRequest(parser.request())
+        : httpErrorResponse(parser.errorStatus());
+    send(clientSocket, response.c_str(), response.size(), 0);
+}
+
+#ifdef __linux__
+const int MAX_EVENT_LOOP_CONNECTIONS = 20000;
+const int MAX_CONNECTIONS_PER_IP = 2000;
+
+// Allow as many descriptors as the hard limit so idle keep-alive clients
+// are limited by memory rather than the default 1024 files.
+static void raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void Server::runEventLoops() {
+    raiseFileLimit();
+    thread_pool = std::make_unique<ThreadPool>(10);  // 10 worker threads for blocking commands
+    // Idle keep-alive sockets are cheap here, so the caps are far higher
+    // than the blocking path's; pooled requests start at two per worker
+    connection_manager = std::make_unique<ConnectionManager>(
+        MAX_EVENT_LOOP_CONNECTIONS, MAX_CONNECTIONS_PER_IP, 20, 10, 1000);
+
+    unsigned loop_count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < loop_count; ++i) {
+        event_loops.push_back(std::make_unique<EventLoop>(
+            port, http_limits, *thread_pool, *connection_manager,
+            [this](const HttpRequest& request) { return handleRequest(request); },
+            [this](const HttpRequest& request) { return router.mayBlock(request.command()); },
+            [this](const HttpRequest& request, std::string& preamble) {
+                if (request.command() != "STREAM_MARKET") return false;
+                preamble = createStreamResponse() + marketSnapshotEvent();
+                return true;
+            },
+            EventLoop::FrameHandler{binaryMayBlock, handleBinaryFrame}));
+        if (!event_loops.back()->listening()) {
+            LOG_ERROR("Failed to start event loop on port " << port);
             return;
-        } else {
-            result = "ERROR|Invalid credentials";
-            success = false;
         }
+    }
 
-    } else {
-        result = "ERROR|Invalid format";
-        success = false;
+    // Push every market.csv change to the stream subscribers of all loops;
+    // the encoded frame is built once and shared
+    quoteTable().addListener([this](const MarketSnapshot& previous, const MarketSnapshot& next) {
+        std::string events = marketDeltaEvent(previous, next);
+        if (events.empty()) return;
+        auto frame = std::make_shared<const std::string>(std::move(events));
+        for (auto& loop : event_loops) {
+            loop->broadcast(frame);
+        }
+    });
+
+    registerSampled("server_threadpool_queue_depth", "", "Requests waiting for a worker", "gauge",
+                    [this] { return static_cast<double>(thread_pool->queued()); });
+    registerSampled("server_connections", "", "Open client connections", "gauge",
+                    [this] { return connection_manager->connections(); });
+    registerSampled("server_requests_in_flight", "", "Pooled requests admitted and not finished", "gauge",
+                    [this] { return connection_manager->requests_in_flight(); });
+    registerSampled("server_request_limit", "", "Current adaptive limit on pooled requests", "gauge",
+                    [this] { return connection_manager->current_request_limit(); });
+    registerSampled("server_connections_rejected_total", "", "Connections turned away with 503", "counter",
+                    [this] { return static_cast<double>(connection_manager->connections_rejected()); });
+    registerSampled("server_requests_shed_total", "", "Requests shed with 503 by the adaptive limit", "counter",
+                    [this] { return static_cast<double>(connection_manager->requests_shed()); });
+
+    LOG_INFO("Server listening on port " << port << " (" << loop_count << " event loops)");
+
+    // Start deadlock monitoring
+    monitorDeadlocks();
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < loop_count; ++i) {
+        threads.emplace_back([this, i] { event_loops[i]->run(); });
+    }
+    event_loops[0]->run();
+    for (auto& thread : threads) {
+        thread.join();
     }
 }
+#endif
 
-    else if (command.rfind("REGISTER|", 0) == 0) {
-        std::istringstream iss(command);
-        std::string action, username, password;
-        std::getline(iss, action, '|');
-        std::getline(iss, username, '|');
-        std::getline(iss, password);
-    
-        if (!username.empty() && !password.empty()) {
-            result = registerUser(username, password) ? "OK|User registered" : "ERROR|User exists";
-            success = result.substr(0, 2) == "OK";
+// Commands that touch the disk, wait for the trade log or scan the trade
+// store are registered as blocking and handed to the worker pool by the
+// event loops; everything else is answered on the event loop thread.
+std::string Server::handleRequest(const HttpRequest& request) {
+    bool keepAlive = request.keepAlive();
+    if (request.method() == "OPTIONS") {
+        // Preflight CORS request
+        return createHttpResponse("", true, "", keepAlive);
+    }
+
+    CommandContext context{request, ""};
+    bool success = true;
+    std::string result = router.run(request.command(), context, success);
+    return createHttpResponse(result, success, context.session_id, keepAlive);
+}
+
+// Most commands one BATCH may carry
+const size_t MAX_BATCH_COMMANDS = 64;
+
+static void appendJsonString(std::string& out, const std::string& text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += "\\u00";
+            out += hex[(c >> 4) & 0xf];
+            out += hex[c & 0xf];
         } else {
-            result = "ERROR|Invalid format";
-            success = false;
+            out += c;
         }
     }
-     else if (command == "GET_MARKET") {
-        result = getMarketData();
-        success = true;
-    } else if (command.rfind("BUY|", 0) == 0) {
-        auto parts = command.substr(4);
-        auto pos1 = parts.find("|");
-        auto pos2 = parts.rfind("|");
-        std::string user = parts.substr(0, pos1);
-        std::string ticker = parts.substr(pos1+1, pos2-pos1-1);
-        int qty = std::stoi(parts.substr(pos2+1));
-        result = buyStock(user, ticker, qty) ? "OK|Trade completed" : "ERROR|Buy failed";
-        success = result.substr(0, 2) == "OK";
-        } else if (command.rfind("SELL|", 0) == 0) {
-        auto parts = command.substr(5);
-        auto pos1 = parts.find("|");
-        auto pos2 = parts.rfind("|");
-        std::string user = parts.substr(0, pos1);
-        std::string ticker = parts.substr(pos1+1, pos2-pos1-1);
-        int qty = std::stoi(parts.substr(pos2+1));
-        result = sellStock(user, ticker, qty) ? "OK|Trade completed" : "ERROR|Sell failed";
-        success = result.substr(0, 2) == "OK";
-    } else if (command.rfind("PORTFOLIO|", 0) == 0) {
-    // Get the sessionId from the HTTP headers (from requestData)
-    std::string sessionId = getSessionIdFromRequest(requestData);
-    std::string sessionUser;
-    {
-        std::lock_guard<std::mutex> lock(sessions_mutex);
-        if (sessions.find(sessionId) != sessions.end()) {
-            sessionUser = sessions[sessionId];
+    out += '"';
+}
+
+// BATCH\n<command>\n<command>... answers with a JSON array of the
+// commands' responses, in order. BUY and SELL lines are applied first as
+// one list (one lock acquisition per account stripe, one log flush); the
+// other commands then run in parallel on the worker pool and see those
+// trades.
+std::string Server::handleBatch(std::string_view body, const HttpRequest& request) {
+    std::vector<std::string_view> commands;
+    while (!body.empty()) {
+        size_t end = body.find('\n');
+        std::string_view line = body.substr(0, end);
+        body.remove_prefix(end == std::string_view::npos ? body.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (!line.empty()) commands.push_back(line);
+    }
+    if (commands.empty() || commands.size() > MAX_BATCH_COMMANDS) return "ERROR|Invalid batch";
+
+    std::vector<std::string> results(commands.size());
+    std::vector<TradeOrder> trades;
+    std::vector<size_t> trade_slots, other_slots;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        std::string_view arguments;
+        Command command = router.parse(commands[i], arguments);
+        if (command == Command::LOGIN || command == Command::BATCH) {
+            results[i] = "ERROR|Not allowed in BATCH";
+            continue;
+        }
+        if (command != Command::BUY && command != Command::SELL) {
+            other_slots.push_back(i);
+            continue;
         }
+        CommandArgs args(arguments);
+        TradeOrder order;
+        if (!parseTradeOrder(args, command == Command::BUY, order)) {
+            results[i] = "ERROR|Invalid format";
+            continue;
+        }
+        trades.push_back(std::move(order));
+        trade_slots.push_back(i);
     }
-    if (!sessionUser.empty()) {
-        result = getPortfolio(sessionUser);
-        success = true;
-    } else {
-        result = "ERROR|Not authenticated";
-        success = false;
+
+    if (!trades.empty()) {
+        std::vector<bool> applied = applyTrades(trades);
+        for (size_t t = 0; t < trades.size(); ++t) {
+            results[trade_slots[t]] = applied[t] ? "OK|Trade completed"
+                                                 : trades[t].buy ? "ERROR|Buy failed" : "ERROR|Sell failed";
+        }
     }
-}
- else if (command.rfind("OPTIONS", 0) == 0 || requestData.rfind("OPTIONS", 0) == 0) {
-        // Handle preflight CORS requests
-        result = "";
-        success = true;
-    } else if (command.rfind("CSV_BUYS|", 0) == 0) {
-        std::string username = command.substr(9);
-        result = getLast3BuysFromCSV(username);
-        success = true;    
-    } else if (command.rfind("RECENT_SELLS|", 0) == 0) {
-        std::string username = command.substr(13);
-        result = getRecentSellsFromCSV(username);
-        success = true;
+
+    auto run = [&](size_t n) {
+        size_t i = other_slots[n];
+        try {
+            CommandContext context{request, ""};
+            bool success;
+            results[i] = router.run(commands[i], context, success);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Error handling batched command: " << e.what());
+            results[i] = "ERROR|Command failed";
+        }
+    };
+    if (thread_pool && other_slots.size() > 1) {
+        thread_pool->parallelFor(other_slots.size(), run);
     } else {
-        result = "ERROR|Unknown command";
-        success = false;
+        for (size_t n = 0; n < other_slots.size(); ++n) run(n);
     }
 
-    // Create HTTP response
-    std::string response = createHttpResponse(result, success);
-    
-    // Send response
-    send(clientSocket, response.c_str(), response.size(), 0);
-    close(clientSocket);
-}
\ No newline at end of file
+    std::string response = "[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i > 0) response += ',';
+        appendJsonString(response, results[i]);
+    }
+    response += ']';
+    return response;
+}
@@ -3,10 +3,14 @@
 
 #include <string>
 #include <memory>
-#include <iostream>
+#include <vector>
+#include "utils/logger.h"
 #include <thread>
 #include <chrono>
 #include "concurrency_managers.h"
+#include "event_loop.h"
+#include "utils/http_parser.h"
+#include "utils/command_router.h"
 
 class Server {
 public:
@@ -17,22 +21,30 @@ public:
 private:
     int port;
     int server_fd = -1;  // Track server socket
+    HttpLimits http_limits;  // Request size limits for every connection
+    CommandRouter router;    // Commands registered by the handler modules
     
     // Smart pointers for thread pool and connection manager
     std::unique_ptr<ThreadPool> thread_pool;
     std::unique_ptr<ConnectionManager> connection_manager;
+#ifdef __linux__
+    std::vector<std::unique_ptr<EventLoop>> event_loops;
+    void runEventLoops();
+#endif
 
     // Existing methods
     void handleClient(int clientSocket);
-    std::string parseHttpRequest(const std::string& request);
-    std::string createHttpResponse(const std::string &content, bool success, const std::string &sessionId = "");
+    std::string handleRequest(const HttpRequest& request);
+    std::string handleBatch(std::string_view body, const HttpRequest& request);
+    std::string createHttpResponse(const std::string &content, bool success, const std::string &sessionId = "", bool keepAlive = false);
+    std::string createStreamResponse();
 
     // Deadlock monitoring method
     void monitorDeadlocks() {
         std::thread monitor([this] {
             while (true) {
                 std::this_thread::sleep_for(std::chrono::minutes(5));
-                std::cout << "Performing deadlock check..." << std::endl;
+                LOG_DEBUG("Performing deadlock check...");
             }
         });
         monitor.detach();
@@ -0,0 +1,144 @@
+// Synthetic dataset for benchmarks: writes users.csv, market.csv,
+// holdings.csv and transactions.csv in the formats under db/, scaled to
+// any size. Holdings are the net result of the generated transactions, so
+// the files agree with each other the way the server keeps them.
+//
+// Users are user<i> with password pass<i> (what loadgen --users expects).
+// The five real tickers come first so the default loadgen mix finds them.
+//
+//   ./gen_dataset --out /tmp/bigdb --users 100000 --tickers 500 --transactions 5000000
+//   (then run the server from a directory whose db/ is that output)
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace {
+
+const char* REAL_TICKERS[][2] = {
+    {"AAPL", "Apple Inc."}, {"MSFT", "Microsoft Corporation"}, {"GOOGL", "Alphabet Inc."},
+    {"AMZN", "Amazon.com Inc."}, {"TSLA", "Tesla Inc."}
+};
+
+// Buffered writer; ofstream's per-row overhead dominates at millions of rows
+class Output {
+public:
+    explicit Output(const std::string& path) : file(std::fopen(path.c_str(), "w")) {
+        if (file) std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        else std::cerr << "Cannot write " << path << std::endl;
+    }
+    ~Output() {
+        if (file) std::fclose(file);
+    }
+    bool ok() const { return file != nullptr; }
+    void line(const std::string& text) {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fputc('\n', file);
+    }
+
+private:
+    std::FILE* file;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string out = "db_synthetic";
+    long users = 10000;
+    long tickers = 100;
+    long transactions = 1000000;
+    unsigned seed = 42;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--out") out = value;
+        else if (arg == "--users") users = std::stol(value);
+        else if (arg == "--tickers") tickers = std::stol(value);
+        else if (arg == "--transactions") transactions = std::stol(value);
+        else if (arg == "--seed") seed = static_cast<unsigned>(std::stoul(value));
+        else {
+            std::cerr << "usage: gen_dataset [--out DIR] [--users N] [--tickers N] [--transactions N] [--seed S]\n";
+            return 1;
+        }
+    }
+    if (argc % 2 == 0 || users < 1 || tickers < 5 || transactions < 0) {
+        std::cerr << "usage: gen_dataset [--out DIR] [--users N] [--tickers N>=5] [--transactions N] [--seed S]\n";
+        return 1;
+    }
+    ::mkdir(out.c_str(), 0755);
+
+    std::mt19937_64 rng(seed);
+
+    std::vector<std::string> symbols;
+    std::vector<float> prices;
+    {
+        Output market(out + "/market.csv");
+        if (!market.ok()) return 1;
+        std::uniform_real_distribution<float> price(5.0f, 900.0f);
+        for (long t = 0; t < tickers; ++t) {
+            std::string symbol = t < 5 ? REAL_TICKERS[t][0] : "T" + std::to_string(t);
+            std::string name = t < 5 ? REAL_TICKERS[t][1] : "Synthetic Corp " + std::to_string(t);
+            float p = static_cast<int>(price(rng) * 100) / 100.0f;
+            symbols.push_back(symbol);
+            prices.push_back(p);
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.2f", p);
+            market.line(symbol + "," + name + "," + text);
+        }
+    }
+
+    {
+        Output users_file(out + "/users.csv");
+        if (!users_file.ok()) return 1;
+        for (long u = 0; u < users; ++u) {
+            users_file.line("user" + std::to_string(u) + ",pass" + std::to_string(u));
+        }
+    }
+
+    // Each user trades a handful of tickers; a user's transactions are
+    // written together, which keeps only one user's positions in memory
+    Output trades(out + "/transactions.csv");
+    Output holdings(out + "/holdings.csv");
+    if (!trades.ok() || !holdings.ok()) return 1;
+
+    std::uniform_int_distribution<long> pick_ticker(0, tickers - 1);
+    std::uniform_int_distribution<int> quantity(1, 20);
+    long remaining = transactions;
+    for (long u = 0; u < users; ++u) {
+        std::string username = "user" + std::to_string(u);
+        long count = remaining / (users - u);
+        if (remaining % (users - u) > static_cast<long>(rng() % (users - u))) ++count;
+        remaining -= count;
+
+        std::vector<std::pair<long, int>> positions;  // (ticker, quantity)
+        int held = 1 + static_cast<int>(rng() % 5);
+        for (int k = 0; k < held; ++k) {
+            long ticker = pick_ticker(rng);
+            bool seen = false;
+            for (const auto& position : positions) seen = seen || position.first == ticker;
+            if (!seen) positions.push_back({ticker, 0});
+        }
+
+        for (long i = 0; i < count; ++i) {
+            auto& position = positions[rng() % positions.size()];
+            int qty = quantity(rng);
+            bool sell = position.second >= qty && rng() % 3 == 0;
+            position.second += sell ? -qty : qty;
+            trades.line(username + (sell ? ",SELL," : ",BUY,") + symbols[position.first] + "," +
+                        std::to_string(qty) + "," + std::to_string(prices[position.first]));
+        }
+        for (const auto& position : positions) {
+            if (position.second > 0) {
+                holdings.line(username + "," + symbols[position.first] + "," + std::to_string(position.second));
+            }
+        }
+    }
+
+    std::cout << "Wrote " << users << " users, " << tickers << " tickers and "
+              << transactions << " transactions to " << out << "/" << std::endl;
+    return 0;
+}
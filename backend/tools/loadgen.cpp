@@ -0,0 +1,448 @@
+// Load generator for the command protocol.
+//
+// Each connection runs on its own thread over HTTP/1.1 keep-alive, logs in
+// once, then sends a weighted mix of commands and records the latency of
+// every response in a per-command histogram.
+//
+//   closed loop (default): send the next request as soon as the previous
+//     response arrives; measures capacity.
+//   open loop (--rate): requests are due on a fixed schedule regardless of
+//     how fast the server answers, and latency is measured from when each
+//     request was due, so a stalled server shows up in the tail instead of
+//     silently lowering the request rate (coordinated omission).
+//
+// Users come from gen_dataset (user<i>/pass<i>); with --users 0 every
+// connection logs in as testuser.
+//
+// --protocol binary speaks the binary protocol (utils/binary_protocol.h)
+// instead: market is QUOTES, and buys/sells, which have no binary message,
+// are left out of the mix. Status OK counts as ok, BUSY as shed and any
+// other status as rejected.
+//
+// Examples:
+//   ./loadgen --connections 32 --duration 20
+//   ./loadgen --rate 5000 --connections 64 --mix market=70,portfolio=20,buy=5,sell=5
+//   ./loadgen --protocol binary --mix market=70,portfolio=20,buy=5,sell=5
+
+#include "../utils/histogram.h"
+#include "../utils/binary_protocol.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Command { LOGIN, MARKET, BUY, SELL, PORTFOLIO, BUYS, SELLS, COMMAND_COUNT };
+
+const char* COMMAND_NAMES[COMMAND_COUNT] = {
+    "LOGIN", "GET_MARKET", "BUY", "SELL", "PORTFOLIO", "CSV_BUYS", "RECENT_SELLS"
+};
+const char* MIX_KEYS[COMMAND_COUNT] = {"login", "market", "buy", "sell", "portfolio", "buys", "sells"};
+const char* TICKERS[] = {"AAPL", "MSFT", "GOOGL", "AMZN", "TSLA"};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8081;
+    int connections = 16;
+    double duration = 10;
+    double warmup = 1;
+    double rate = 0;  // total requests/s; 0 means closed loop
+    int users = 0;
+    bool binary = false;
+    int weights[COMMAND_COUNT] = {2, 40, 10, 8, 20, 10, 10};
+};
+
+struct WorkerStats {
+    Histogram latency[COMMAND_COUNT];
+    uint64_t ok = 0;
+    uint64_t rejected = 0;    // 4xx answers, e.g. a SELL with nothing to sell
+    uint64_t shed = 0;        // 503 from admission control
+    uint64_t failures = 0;    // connect/send/receive errors
+};
+
+bool parseMix(const std::string& spec, int weights[COMMAND_COUNT]) {
+    std::fill(weights, weights + COMMAND_COUNT, 0);
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) return false;
+        std::string key = item.substr(0, equals);
+        int weight = std::atoi(item.c_str() + equals + 1);
+        bool known = false;
+        for (int c = 0; c < COMMAND_COUNT; ++c) {
+            if (key == MIX_KEYS[c]) {
+                weights[c] = weight;
+                known = true;
+            }
+        }
+        if (!known || weight < 0) return false;
+    }
+    return true;
+}
+
+// Body of a binary LOGIN request
+std::string binaryLoginBody(const std::string& username, const std::string& password) {
+    std::string body(4, '\0');
+    binary_protocol::store<uint16_t>(&body[0], static_cast<uint16_t>(username.size()));
+    binary_protocol::store<uint16_t>(&body[2], static_cast<uint16_t>(password.size()));
+    return body + username + password;
+}
+
+class Connection {
+public:
+    Connection(const Options& options) : options(options) {}
+    ~Connection() { disconnect(); }
+
+    bool connected() const { return fd >= 0; }
+
+    bool connect() {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.port);
+        inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+        if (::connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            disconnect();
+            return false;
+        }
+        if (options.binary) {
+            // The server confirms the protocol by echoing the magic
+            using binary_protocol::MAGIC;
+            using binary_protocol::MAGIC_SIZE;
+            if (!sendAll(std::string(MAGIC, MAGIC_SIZE))) return false;
+            while (buffer.size() < MAGIC_SIZE) {
+                if (!fill()) return false;
+            }
+            if (buffer.compare(0, MAGIC_SIZE, MAGIC, MAGIC_SIZE) != 0) return false;
+            buffer.erase(0, MAGIC_SIZE);
+        }
+        return true;
+    }
+
+    void disconnect() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        buffer.clear();
+    }
+
+    // Send one binary request; returns 200, 503 (BUSY) or 400 (any other
+    // status) like exchange, or 0 if the connection failed
+    int exchangeFrame(uint16_t type, const std::string& request_body, std::string& body) {
+        using namespace binary_protocol;
+        std::string frame;
+        char* at = appendFrame(frame, type, OK, ++next_tag, request_body.size());
+        std::memcpy(at, request_body.data(), request_body.size());
+        if (!sendAll(frame)) return 0;
+
+        while (buffer.size() < HEADER_SIZE || buffer.size() < frameLength(buffer.data())) {
+            if (!fill()) return 0;
+        }
+        uint32_t length = frameLength(buffer.data());
+        uint16_t status = frameStatus(buffer.data());
+        if (length < HEADER_SIZE || frameTag(buffer.data()) != next_tag) return 0;
+        body = buffer.substr(HEADER_SIZE, length - HEADER_SIZE);
+        buffer.erase(0, length);
+        return status == OK ? 200 : status == BUSY ? 503 : 400;
+    }
+
+    // Binary LOGIN, then SYMBOLS to learn the ticker ids
+    bool binaryLogin(const std::string& username, const std::string& password) {
+        std::string body;
+        if (exchangeFrame(binary_protocol::LOGIN, binaryLoginBody(username, password), body) != 200) return false;
+        if (exchangeFrame(binary_protocol::SYMBOLS, "", body) != 200 || body.size() < 4) return false;
+
+        ticker_ids.clear();
+        uint32_t count = binary_protocol::load<uint32_t>(body.data());
+        size_t at = 4;
+        for (uint32_t i = 0; i < count && at + 6 <= body.size(); ++i) {
+            uint32_t id = binary_protocol::load<uint32_t>(body.data() + at);
+            uint16_t length = binary_protocol::load<uint16_t>(body.data() + at + 4);
+            ticker_ids[body.substr(at + 6, length)] = id;
+            at += 6 + length;
+        }
+        return true;
+    }
+
+    std::unordered_map<std::string, uint32_t> ticker_ids;
+
+    // Send one command; returns the HTTP status, or 0 if the connection failed
+    int exchange(const std::string& command, std::string& body) {
+        std::string request = "POST / HTTP/1.1\r\nHost: " + options.host +
+                              "\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(command.size()) +
+                              "\r\n";
+        if (!cookie.empty()) request += "Cookie: sessionId=" + cookie + "\r\n";
+        request += "\r\n" + command;
+        if (!sendAll(request)) return 0;
+        return readResponse(body);
+    }
+
+    std::string cookie;
+
+private:
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    int readResponse(std::string& body) {
+        size_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) return 0;
+        }
+        std::string headers = buffer.substr(0, header_end);
+        int status = std::atoi(headers.c_str() + headers.find(' ') + 1);
+
+        size_t length = 0;
+        size_t pos = headers.find("Content-Length:");
+        if (pos != std::string::npos) length = std::strtoul(headers.c_str() + pos + 15, nullptr, 10);
+        pos = headers.find("sessionId=");
+        if (pos != std::string::npos) {
+            size_t end = headers.find_first_of(";\r", pos);
+            cookie = headers.substr(pos + 10, end - pos - 10);
+        }
+        bool close_after = headers.find("Connection: close") != std::string::npos;
+
+        while (buffer.size() < header_end + 4 + length) {
+            if (!fill()) return 0;
+        }
+        body = buffer.substr(header_end + 4, length);
+        buffer.erase(0, header_end + 4 + length);
+        if (close_after) disconnect();
+        return status;
+    }
+
+    bool fill() {
+        char chunk[16384];
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer.append(chunk, n);
+        return true;
+    }
+
+    const Options& options;
+    int fd = -1;
+    std::string buffer;
+    uint64_t next_tag = 0;
+};
+
+// The binary request for command, as message type and body
+uint16_t binaryRequest(int command, const Connection& conn, const char* ticker, const std::string& username,
+                       const std::string& password, std::string& body) {
+    body.clear();
+    switch (command) {
+        case LOGIN:
+            body = binaryLoginBody(username, password);
+            return binary_protocol::LOGIN;
+        case BUY:
+        case SELL: {
+            auto it = conn.ticker_ids.find(ticker);
+            binary_protocol::TradeBody trade{it == conn.ticker_ids.end() ? UINT32_MAX : it->second, 1};
+            body.resize(sizeof(trade));
+            binary_protocol::store(&body[0], trade);
+            return command == BUY ? binary_protocol::BUY : binary_protocol::SELL;
+        }
+        case PORTFOLIO:
+            return binary_protocol::PORTFOLIO;
+        default:
+            return binary_protocol::QUOTES;
+    }
+}
+
+void runConnection(const Options& options, int index, Clock::time_point start,
+                   Clock::time_point measure_from, Clock::time_point end, WorkerStats& stats) {
+    std::mt19937 rng(12345 + index);
+    int total_weight = 0;
+    for (int w : options.weights) total_weight += w;
+
+    std::string username = options.users > 0 ? "user" + std::to_string(index % options.users) : "testuser";
+    std::string password = options.users > 0 ? "pass" + std::to_string(index % options.users) : "testpass";
+
+    // Open loop: this connection's share of the rate, staggered across connections
+    Clock::duration interval{};
+    Clock::time_point due = start;
+    if (options.rate > 0) {
+        interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.connections / options.rate));
+        due += interval * index / options.connections;
+    }
+
+    Connection conn(options);
+    std::string body;
+
+    while (Clock::now() < end) {
+        if (!conn.connected()) {
+            conn.cookie.clear();
+            bool logged_in = conn.connect() && (options.binary ? conn.binaryLogin(username, password)
+                                                               : conn.exchange("LOGIN|" + username + "|" + password,
+                                                                               body) == 200);
+            if (!logged_in) {
+                if (Clock::now() >= measure_from) ++stats.failures;
+                conn.disconnect();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+        }
+
+        int pick = std::uniform_int_distribution<int>(0, total_weight - 1)(rng);
+        int command = 0;
+        while (pick >= options.weights[command]) pick -= options.weights[command++];
+
+        std::string text;
+        uint16_t type = 0;
+        const char* ticker = TICKERS[rng() % 5];
+        if (options.binary) {
+            type = binaryRequest(command, conn, ticker, username, password, text);
+        } else {
+            switch (command) {
+                case LOGIN:     text = "LOGIN|" + username + "|" + password; break;
+                case MARKET:    text = "GET_MARKET"; break;
+                case BUY:       text = "BUY|" + username + "|" + ticker + "|1"; break;
+                case SELL:      text = "SELL|" + username + "|" + ticker + "|1"; break;
+                case PORTFOLIO: text = "PORTFOLIO|" + username; break;
+                case BUYS:      text = "CSV_BUYS|" + username; break;
+                case SELLS:     text = "RECENT_SELLS|" + username; break;
+            }
+        }
+
+        Clock::time_point sent_at;
+        if (options.rate > 0) {
+            std::this_thread::sleep_until(due);
+            sent_at = due;  // charge any lateness to the server
+            due += interval;
+        } else {
+            sent_at = Clock::now();
+        }
+
+        int status = options.binary ? conn.exchangeFrame(type, text, body) : conn.exchange(text, body);
+        Clock::time_point done = Clock::now();
+        if (status == 0) {
+            if (sent_at >= measure_from) ++stats.failures;
+            conn.disconnect();
+            continue;
+        }
+        if (sent_at < measure_from) continue;
+
+        stats.latency[command].record(std::chrono::duration_cast<std::chrono::nanoseconds>(done - sent_at).count());
+        if (status == 200) ++stats.ok;
+        else if (status == 503) ++stats.shed;
+        else ++stats.rejected;
+    }
+}
+
+void printRow(const std::string& name, const Histogram& h) {
+    auto us = [](uint64_t ns) { return ns / 1000.0; };
+    std::cout << std::left << std::setw(14) << name << std::right
+              << std::setw(10) << h.count()
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << us(h.percentile(50))
+              << std::setw(10) << us(h.percentile(99))
+              << std::setw(10) << us(h.percentile(99.9))
+              << std::setw(10) << us(h.max()) << "\n";
+}
+
+void usage() {
+    std::cerr << "usage: loadgen [--host 127.0.0.1] [--port 8081] [--connections 16] [--duration 10]\n"
+                 "               [--warmup 1] [--rate REQ_PER_S] [--users N] [--protocol http|binary]\n"
+                 "               [--mix login=2,market=40,buy=10,sell=8,portfolio=20,buys=10,sells=10]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = std::stoi(value);
+        else if (arg == "--connections") options.connections = std::stoi(value);
+        else if (arg == "--duration") options.duration = std::stod(value);
+        else if (arg == "--warmup") options.warmup = std::stod(value);
+        else if (arg == "--rate") options.rate = std::stod(value);
+        else if (arg == "--users") options.users = std::stoi(value);
+        else if (arg == "--protocol" && (value == "http" || value == "binary")) options.binary = value == "binary";
+        else if (arg == "--mix") {
+            if (!parseMix(value, options.weights)) {
+                std::cerr << "Bad --mix: " << value << std::endl;
+                return 1;
+            }
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (options.binary) options.weights[BUYS] = options.weights[SELLS] = 0;
+    int total_weight = 0;
+    for (int w : options.weights) total_weight += w;
+    if (options.connections < 1 || options.duration <= 0 || total_weight == 0) {
+        usage();
+        return 1;
+    }
+
+    auto start = Clock::now();
+    auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    auto end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+    std::vector<WorkerStats> stats(options.connections);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.connections; ++i) {
+        threads.emplace_back([&, i] { runConnection(options, i, start, measure_from, end, stats[i]); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    WorkerStats total;
+    for (const auto& s : stats) {
+        for (int c = 0; c < COMMAND_COUNT; ++c) total.latency[c].merge(s.latency[c]);
+        total.ok += s.ok;
+        total.rejected += s.rejected;
+        total.shed += s.shed;
+        total.failures += s.failures;
+    }
+    Histogram all;
+    for (const auto& h : total.latency) all.merge(h);
+
+    std::cout << (options.rate > 0 ? "open loop at " + std::to_string(static_cast<long>(options.rate)) + " req/s"
+                                   : std::string("closed loop"))
+              << (options.binary ? ", binary protocol" : "") << ", " << options.connections << " connections, "
+              << options.duration << " s\n"
+              << std::fixed << std::setprecision(1)
+              << "requests " << all.count() << " (" << all.count() / options.duration << "/s)"
+              << ", ok " << total.ok << ", rejected " << total.rejected
+              << ", shed 503 " << total.shed << ", connection errors " << total.failures << "\n\n"
+              << std::left << std::setw(14) << "command" << std::right << std::setw(10) << "count"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "p999 us"
+              << std::setw(10) << "max us" << "\n";
+    for (int c = 0; c < COMMAND_COUNT; ++c) {
+        if (total.latency[c].count() > 0) printRow(COMMAND_NAMES[c], total.latency[c]);
+    }
+    printRow("all", all);
+    return total.failures > 0 && all.count() == 0 ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Binary wire protocol, an alternative to HTTP and the text pipe commands
+// for clients that connect directly (e.g. trading bots).
+//
+// A connection opts in by sending the 8 bytes of MAGIC before anything
+// else; the server answers with the same 8 bytes and from then on both
+// sides exchange frames. Every frame starts with a fixed 16-byte header:
+//
+//   u32 length   whole frame, header included
+//   u16 type     MessageType; a reply carries its request's type
+//   u16 status   Status of a reply (0 in requests)
+//   u64 tag      chosen by the client, echoed in the reply
+//
+// followed by a fixed-layout body. All integers and doubles are
+// little-endian, prices are IEEE doubles in dollars, and tickers are
+// 32-bit ids interned by the server (SYMBOLS lists them; ids stay valid
+// until the server restarts). Replies come back in request order.
+//
+// Bodies (requests -> replies):
+//   LOGIN      u16 user length, u16 password length, user, password -> -
+//   SYMBOLS    -  -> u32 count, count x (u32 id, u16 length, name)
+//   QUOTES     -  -> u32 count, u32 0, count x QuoteEntry
+//   BUY, SELL  TradeBody -> -
+//   PORTFOLIO  -  -> u32 count, u32 0, count x PositionEntry
+// LOGIN binds the connection to a user; BUY, SELL and PORTFOLIO act for
+// that user.
+//
+// Everything here is header-only and allocation-free so clients (such as
+// tools/loadgen) can use it without the server.
+namespace binary_protocol {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the wire format is little-endian");
+
+constexpr char MAGIC[8] = {'\0', 'S', 'T', 'K', 'B', 'I', 'N', '\x01'};  // last byte: version
+constexpr size_t MAGIC_SIZE = sizeof(MAGIC);
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t MAX_FRAME = 1 << 16;  // largest request accepted
+
+enum MessageType : uint16_t { LOGIN = 1, SYMBOLS = 2, QUOTES = 3, BUY = 4, SELL = 5, PORTFOLIO = 6 };
+
+enum Status : uint16_t {
+    OK = 0,
+    BAD_FRAME = 1,       // wrong size for its type
+    UNKNOWN_TYPE = 2,
+    NOT_LOGGED_IN = 3,
+    BAD_CREDENTIALS = 4,
+    UNKNOWN_TICKER = 5,
+    REJECTED = 6,        // the trade did not go through (price, holdings, log)
+    BUSY = 7             // shed by admission control; retry later
+};
+
+struct TradeBody {
+    uint32_t ticker;
+    int32_t quantity;
+};
+
+struct QuoteEntry {
+    uint32_t ticker;
+    uint32_t reserved;
+    double price;
+};
+
+struct PositionEntry {
+    uint32_t ticker;
+    int32_t quantity;
+    double value;       // at the server's current price
+    double cost_basis;  // average cost of the shares held
+};
+
+static_assert(sizeof(TradeBody) == 8 && sizeof(QuoteEntry) == 16 && sizeof(PositionEntry) == 24,
+              "wire structs must have no padding");
+
+template <typename T>
+inline T load(const char* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void store(char* at, T value) {
+    std::memcpy(at, &value, sizeof(T));
+}
+
+// Header fields of a frame with at least HEADER_SIZE bytes
+inline uint32_t frameLength(const char* frame) { return load<uint32_t>(frame); }
+inline uint16_t frameType(const char* frame) { return load<uint16_t>(frame + 4); }
+inline uint16_t frameStatus(const char* frame) { return load<uint16_t>(frame + 6); }
+inline uint64_t frameTag(const char* frame) { return load<uint64_t>(frame + 8); }
+
+// Append a frame with room for body_size bytes of body and return where
+// the body starts (valid until out grows again)
+inline char* appendFrame(std::string& out, uint16_t type, uint16_t status, uint64_t tag, size_t body_size) {
+    size_t start = out.size();
+    out.resize(start + HEADER_SIZE + body_size);
+    char* frame = &out[start];
+    store<uint32_t>(frame, static_cast<uint32_t>(HEADER_SIZE + body_size));
+    store<uint16_t>(frame + 4, type);
+    store<uint16_t>(frame + 6, status);
+    store<uint64_t>(frame + 8, tag);
+    return frame + HEADER_SIZE;
+}
+
+// A body-less reply to request with this status
+inline void appendStatus(std::string& out, std::string_view request, uint16_t status) {
+    appendFrame(out, frameType(request.data()), status, frameTag(request.data()), 0);
+}
+
+}  // namespace binary_protocol
+
+#endif
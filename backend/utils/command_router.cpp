@@ -0,0 +1,68 @@
+#include "command_router.h"
+#include "metrics.h"
+#include <vector>
+
+namespace {
+
+// Handling time per command, excluding queueing; the last one counts
+// commands that matched no route
+const LatencyHistogram& durationOf(Command command) {
+    static const std::vector<LatencyHistogram> histograms = [] {
+        std::vector<LatencyHistogram> result;
+        for (std::string_view name : COMMAND_NAMES) {
+            result.emplace_back("server_command_duration_seconds", "command=\"" + std::string(name) + "\"",
+                                "Time to handle one command, excluding queueing");
+        }
+        result.emplace_back("server_command_duration_seconds", "command=\"OTHER\"", "");
+        return result;
+    }();
+    return histograms[static_cast<size_t>(command)];
+}
+
+}  // namespace
+
+void CommandRouter::add(Command command, Arguments arguments, bool may_block, CommandHandler handler) {
+    Route& route = routes[static_cast<size_t>(command)];
+    route.handler = std::move(handler);
+    route.arguments = arguments;
+    route.may_block = may_block;
+}
+
+Command CommandRouter::parse(std::string_view line, std::string_view& arguments) const {
+    size_t end = line.find_first_of("|\n");
+    Command command = lookupCommand(line.substr(0, end));
+    if (command == Command::COUNT) return command;
+
+    const Route& route = routes[static_cast<size_t>(command)];
+    if (!route.handler) return Command::COUNT;
+    if (end == std::string_view::npos) {
+        arguments = std::string_view();
+        return route.arguments == NO_ARGUMENTS ? command : Command::COUNT;
+    }
+    // BATCH puts one command per line; everything else separates with '|'
+    char separator = command == Command::BATCH ? '\n' : '|';
+    if (route.arguments == NO_ARGUMENTS || line[end] != separator) return Command::COUNT;
+    arguments = line.substr(end + 1);
+    return command;
+}
+
+bool CommandRouter::mayBlock(std::string_view line) const {
+    std::string_view arguments;
+    Command command = parse(line, arguments);
+    return command != Command::COUNT && routes[static_cast<size_t>(command)].may_block;
+}
+
+std::string CommandRouter::run(std::string_view line, CommandContext& context, bool& success) const {
+    std::string_view arguments;
+    Command command = parse(line, arguments);
+    ScopedTimer timer(durationOf(command));
+    if (command == Command::COUNT) {
+        success = false;
+        return "ERROR|Unknown command";
+    }
+
+    CommandArgs args(arguments);
+    std::string result = routes[static_cast<size_t>(command)].handler(args, context);
+    success = result.compare(0, 6, "ERROR|") != 0;
+    return result;
+}
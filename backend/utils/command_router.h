@@ -0,0 +1,185 @@
+#ifndef COMMAND_ROUTER_H
+#define COMMAND_ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+
+class HttpRequest;
+
+// Every command of the pipe protocol. The name is the text before the
+// first '|' (or before the first newline for BATCH).
+enum class Command : uint8_t {
+    LOGIN, REGISTER, GET_MARKET, STREAM_MARKET, BUY, SELL, PORTFOLIO, CSV_BUYS, RECENT_SELLS, HISTORY, PNL,
+    VOLUME, LIMIT, CANCEL, MODIFY, CANDLES, BATCH, METRICS, COUNT
+};
+
+constexpr std::string_view COMMAND_NAMES[] = {
+    "LOGIN", "REGISTER", "GET_MARKET", "STREAM_MARKET", "BUY", "SELL", "PORTFOLIO", "CSV_BUYS", "RECENT_SELLS",
+    "HISTORY", "PNL", "VOLUME", "LIMIT", "CANCEL", "MODIFY", "CANDLES", "BATCH", "METRICS"
+};
+constexpr size_t COMMAND_COUNT = static_cast<size_t>(Command::COUNT);
+static_assert(sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]) == COMMAND_COUNT, "a Command without a name");
+
+// Compile-time perfect hash of the command names: FNV-1a with a seed
+// searched for at compile time so that every name lands in its own slot of
+// a small table. Looking a name up is one hash of it, one table load and
+// one comparison, however many commands there are.
+namespace command_hash {
+
+constexpr size_t TABLE_SIZE = 64;  // power of two, a few times COMMAND_COUNT
+constexpr uint8_t EMPTY = 0xff;
+static_assert(TABLE_SIZE >= 2 * COMMAND_COUNT, "grow TABLE_SIZE with the command list");
+
+constexpr uint32_t hash(std::string_view name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : name) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr bool collisionFree(uint32_t seed) {
+    bool used[TABLE_SIZE] = {};
+    for (std::string_view name : COMMAND_NAMES) {
+        size_t slot = hash(name, seed) & (TABLE_SIZE - 1);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    uint32_t seed = 0;
+    while (!collisionFree(seed)) ++seed;
+    return seed;
+}
+
+constexpr uint32_t SEED = findSeed();
+
+constexpr std::array<uint8_t, TABLE_SIZE> buildTable() {
+    std::array<uint8_t, TABLE_SIZE> table{};
+    for (auto& slot : table) slot = EMPTY;
+    for (size_t i = 0; i < COMMAND_COUNT; ++i) {
+        table[hash(COMMAND_NAMES[i], SEED) & (TABLE_SIZE - 1)] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, TABLE_SIZE> TABLE = buildTable();
+
+}  // namespace command_hash
+
+// The command a name stands for, or Command::COUNT if none
+constexpr Command lookupCommand(std::string_view name) {
+    uint8_t index = command_hash::TABLE[command_hash::hash(name, command_hash::SEED) &
+                                        (command_hash::TABLE_SIZE - 1)];
+    return index != command_hash::EMPTY && COMMAND_NAMES[index] == name ? static_cast<Command>(index)
+                                                                         : Command::COUNT;
+}
+
+static_assert(lookupCommand("PORTFOLIO") == Command::PORTFOLIO, "command hash table is broken");
+static_assert(lookupCommand("PORTFOLI") == Command::COUNT, "command hash table is broken");
+
+// The '|'-separated fields of a command's arguments, read in order as
+// views into the request (nothing is copied or allocated). Numbers must
+// fill their whole field.
+class CommandArgs {
+public:
+    explicit CommandArgs(std::string_view text) : text(text), more(!text.empty()) {}
+
+    bool next(std::string_view& field) {
+        if (!more) return false;
+        size_t bar = text.find('|');
+        field = text.substr(0, bar);
+        more = bar != std::string_view::npos;
+        text.remove_prefix(more ? bar + 1 : text.size());
+        return true;
+    }
+
+    bool next(std::string& field) {
+        std::string_view view;
+        if (!next(view)) return false;
+        field.assign(view);
+        return true;
+    }
+
+    template <typename T>
+    bool next(T& value) {
+        std::string_view field;
+        if (!next(field)) return false;
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == std::errc() && result.ptr == field.data() + field.size();
+    }
+
+    // Everything not read yet, '|' included (e.g. a password)
+    bool rest(std::string_view& value) {
+        if (!more) return false;
+        value = text;
+        more = false;
+        return true;
+    }
+
+    // Fields not read yet
+    size_t remaining() const {
+        if (!more) return 0;
+        size_t count = 1;
+        for (char c : text) count += c == '|';
+        return count;
+    }
+
+    bool done() const { return !more; }
+
+private:
+    std::string_view text;
+    bool more;
+};
+
+// What a handler sees besides its arguments
+struct CommandContext {
+    const HttpRequest& request;  // for the session cookie
+    std::string session_id;      // set by LOGIN to issue a session cookie
+};
+
+// Returns the response text; "ERROR|..." marks a failed command
+using CommandHandler = std::function<std::string(CommandArgs& args, CommandContext& context)>;
+
+// Routes pipe commands to handlers registered by the handler modules.
+//
+// Routes live in an array indexed by Command, found through the
+// compile-time hash above, so dispatch does not depend on the number of
+// commands. Each route records whether the command may block (and so runs
+// on the worker pool rather than the event loop) and gets a handling-time
+// histogram. Routes are added before the server starts and only read
+// after that.
+class CommandRouter {
+public:
+    enum Arguments : uint8_t { NO_ARGUMENTS, WITH_ARGUMENTS };
+
+    void add(Command command, Arguments arguments, bool may_block, CommandHandler handler);
+
+    // Split a command line into its command and the text after the name;
+    // Command::COUNT if no route matches
+    Command parse(std::string_view line, std::string_view& arguments) const;
+
+    bool mayBlock(std::string_view line) const;
+
+    // Run a command line; success is false for unknown commands and
+    // "ERROR|..." responses
+    std::string run(std::string_view line, CommandContext& context, bool& success) const;
+
+private:
+    struct Route {
+        CommandHandler handler;
+        Arguments arguments = NO_ARGUMENTS;
+        bool may_block = false;
+    };
+    std::array<Route, COMMAND_COUNT> routes;
+};
+
+#endif
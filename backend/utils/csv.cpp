@@ -1,39 +1,303 @@
 #include "csv.h"
-#include <fstream>
-#include <sstream>
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_X86 1
+#endif
 
-std::vector<std::vector<std::string>> readCSV(const std::string& filename) {
-    std::ifstream file(filename);
-    std::vector<std::vector<std::string>> data;
-    std::string line;
-    while (getline(file, line)) {
-        std::stringstream ss(line);
-        std::string cell;
-        std::vector<std::string> row;
-        while (getline(ss, cell, ',')) {
-            row.push_back(cell);
+namespace {
+
+const LatencyHistogram& csvDuration(const char* op) {
+    static const LatencyHistogram read("server_csv_io_duration_seconds", "op=\"read\"", "Time spent reading or writing a CSV file");
+    static const LatencyHistogram append("server_csv_io_duration_seconds", "op=\"append\"", "");
+    static const LatencyHistogram write("server_csv_io_duration_seconds", "op=\"write\"", "");
+    return op[0] == 'r' ? read : op[0] == 'a' ? append : write;
+}
+
+// Files below this size are read() into a buffer instead of mapped, which
+// is cheaper for them. Mapping is safe because the db/ files are only ever
+// appended to or replaced whole (replaceFile); a mapped file that shrank
+// underneath us would fault with SIGBUS.
+const size_t MAP_THRESHOLD = 256 * 1024;
+
+// Bytes classified per call to the delimiter kernel (64 masks of 64 bytes)
+const size_t BLOCK = 64;
+const size_t BATCH_BLOCKS = 64;
+
+// Delimiter kernels: for each 64-byte block, set bit i of the mask when
+// byte i is ',' or '\n'
+using MaskKernel = void (*)(const char* data, size_t blocks, uint64_t* masks);
+
+void scalarMasks(const char* data, size_t blocks, uint64_t* masks) {
+    for (size_t b = 0; b < blocks; ++b) {
+        const char* p = data + b * BLOCK;
+        uint64_t mask = 0;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            mask |= static_cast<uint64_t>(p[i] == ',' || p[i] == '\n') << i;
+        }
+        masks[b] = mask;
+    }
+}
+
+#ifdef CSV_X86
+__attribute__((target("sse2")))
+void sse2Masks(const char* data, size_t blocks, uint64_t* masks) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (size_t b = 0; b < blocks; ++b) {
+        const char* p = data + b * BLOCK;
+        uint64_t mask = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + lane * 16));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, newline));
+            mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (lane * 16);
+        }
+        masks[b] = mask;
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2Masks(const char* data, size_t blocks, uint64_t* masks) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (size_t b = 0; b < blocks; ++b) {
+        const char* p = data + b * BLOCK;
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        __m256i low_hits = _mm256_or_si256(_mm256_cmpeq_epi8(low, comma), _mm256_cmpeq_epi8(low, newline));
+        __m256i high_hits = _mm256_or_si256(_mm256_cmpeq_epi8(high, comma), _mm256_cmpeq_epi8(high, newline));
+        masks[b] = static_cast<uint32_t>(_mm256_movemask_epi8(low_hits)) |
+                   static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high_hits))) << 32;
+    }
+}
+#endif
+
+MaskKernel selectKernel() {
+    if (const char* forced = std::getenv("CSV_SIMD")) {
+        if (std::strcmp(forced, "scalar") == 0) return scalarMasks;
+#ifdef CSV_X86
+        if (std::strcmp(forced, "sse2") == 0) return sse2Masks;
+#endif
+    }
+#ifdef CSV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return avx2Masks;
+    if (__builtin_cpu_supports("sse2")) return sse2Masks;
+#endif
+    return scalarMasks;
+}
+
+MaskKernel kernel() {
+    static const MaskKernel selected = selectKernel();
+    return selected;
+}
+
+// A file's bytes, mapped or read into memory
+class FileBytes {
+public:
+    explicit FileBytes(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        version = snapshotVersion(fd);
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_t size = static_cast<size_t>(st.st_size);
+            if (size >= MAP_THRESHOLD) {
+                void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    ::madvise(mapped, size, MADV_SEQUENTIAL);
+                    map = mapped;
+                    bytes = static_cast<const char*>(mapped);
+                    length = size;
+                }
+            }
+            if (!map) readAll(fd);
+        }
+        ::close(fd);
+    }
+    ~FileBytes() {
+        if (map) ::munmap(map, length);
+    }
+    FileBytes(const FileBytes&) = delete;
+    FileBytes& operator=(const FileBytes&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    SnapshotVersion version;
+
+private:
+    void readAll(int fd) {
+        char chunk[64 * 1024];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            copy.append(chunk, static_cast<size_t>(n));
+        }
+        bytes = copy.data();
+        length = copy.size();
+    }
+
+    void* map = nullptr;
+    std::string copy;
+    const char* bytes = nullptr;
+    size_t length = 0;
+};
+
+bool appendFile(const std::string& filename, const std::string& data) {
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | O_APPEND, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
         }
-        data.push_back(row);
+        written += static_cast<size_t>(n);
     }
+    ::close(fd);
+    return written == data.size();
+}
+
+}  // namespace
+
+size_t CsvTokenizer::scanFile(const std::string& filename, RowCallback callback, void* context,
+                              SnapshotVersion* version) {
+    ScopedTimer timer(csvDuration("read"));
+    FileBytes file(filename);
+    if (version) *version = file.version;
+    return scan(file.data(), file.size(), callback, context);
+}
+
+size_t CsvTokenizer::scan(const char* data, size_t size, RowCallback callback, void* context) {
+    CsvRow row;
+    size_t rows = 0;
+    size_t cell_start = 0;
+
+    auto endCell = [&](size_t end) {
+        if (row.count < CsvRow::MAX_CELLS) row.cells[row.count] = std::string_view(data + cell_start, end - cell_start);
+        ++row.count;
+        cell_start = end + 1;
+    };
+    auto endRow = [&](size_t end) {
+        if (end > cell_start) endCell(end);  // a trailing empty cell is dropped
+        if (row.count > CsvRow::MAX_CELLS) row.count = CsvRow::MAX_CELLS;
+        callback(context, row);
+        row.count = 0;
+        cell_start = end + 1;
+        ++rows;
+    };
+    auto delimiter = [&](size_t position) {
+        if (data[position] == ',') endCell(position);
+        else endRow(position);
+    };
+
+    // Whole blocks straight from the buffer, in batches
+    const MaskKernel classify = kernel();
+    uint64_t masks[BATCH_BLOCKS];
+    size_t offset = 0;
+    while (size - offset >= BLOCK) {
+        size_t blocks = std::min(BATCH_BLOCKS, (size - offset) / BLOCK);
+        classify(data + offset, blocks, masks);
+        for (size_t b = 0; b < blocks; ++b, offset += BLOCK) {
+            for (uint64_t mask = masks[b]; mask != 0; mask &= mask - 1) {
+                delimiter(offset + static_cast<size_t>(__builtin_ctzll(mask)));
+            }
+        }
+    }
+
+    // The tail, padded to one block
+    if (offset < size) {
+        char tail[BLOCK] = {};
+        std::memcpy(tail, data + offset, size - offset);
+        classify(tail, 1, masks);
+        for (uint64_t mask = masks[0]; mask != 0; mask &= mask - 1) {
+            delimiter(offset + static_cast<size_t>(__builtin_ctzll(mask)));
+        }
+    }
+
+    // Last line without a newline
+    if (size > 0 && data[size - 1] != '\n') endRow(size);
+    return rows;
+}
+
+void CsvWriter::separator() {
+    if (!at_row_start) buffer += ',';
+    at_row_start = false;
+}
+
+CsvWriter& CsvWriter::cell(std::string_view text) {
+    separator();
+    buffer.append(text.data(), text.size());
+    return *this;
+}
+
+CsvWriter& CsvWriter::cell(long long value) {
+    separator();
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+    return *this;
+}
+
+CsvWriter& CsvWriter::cell(double value, int precision) {
+    separator();
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    if (result.ec == std::errc()) buffer.append(digits, result.ptr);
+    return *this;
+}
+
+void CsvWriter::endRow() {
+    buffer += '\n';
+    at_row_start = true;
+}
+
+bool CsvWriter::writeTo(const std::string& filename) const {
+    ScopedTimer timer(csvDuration("write"));
+    return replaceFile(filename, buffer);
+}
+
+bool CsvWriter::appendTo(const std::string& filename) const {
+    ScopedTimer timer(csvDuration("append"));
+    return appendFile(filename, buffer);
+}
+
+std::vector<std::vector<std::string>> readCSV(const std::string& filename) {
+    std::vector<std::vector<std::string>> data;
+    visitCSV(filename, [&data](const CsvRow& row) {
+        auto& copy = data.emplace_back();
+        copy.reserve(row.size());
+        for (size_t i = 0; i < row.size(); ++i) copy.emplace_back(row[i]);
+    });
     return data;
 }
 
 void appendCSV(const std::string& filename, const std::vector<std::string>& row) {
-    std::ofstream file(filename, std::ios::app);
-    for (size_t i = 0; i < row.size(); ++i) {
-        file << row[i];
-        if (i < row.size() - 1) file << ",";
-    }
-    file << "\n";
+    CsvWriter writer;
+    for (const auto& cell : row) writer.cell(cell);
+    writer.endRow();
+    writer.appendTo(filename);
 }
 
 void writeCSV(const std::string& filename, const std::vector<std::vector<std::string>>& rows) {
-    std::ofstream file(filename);
+    CsvWriter writer;
     for (const auto& row : rows) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            file << row[i];
-            if (i < row.size() - 1) file << ",";
-        }
-        file << "\n";
+        for (const auto& cell : row) writer.cell(cell);
+        writer.endRow();
     }
+    writer.writeTo(filename);
 }
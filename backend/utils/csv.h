@@ -2,10 +2,100 @@
 #define CSV_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <charconv>
+#include <cstddef>
+#include <type_traits>
+#include "snapshot.h"
 
+// Cells of one line, pointing into the file buffer; valid only during the
+// visitor call. Follows the old getline-based splitting: a trailing empty
+// cell is dropped, an empty line has no cells, and '\r' is left in place.
+class CsvRow {
+public:
+    static const size_t MAX_CELLS = 16;  // further cells are ignored
+
+    size_t size() const { return count; }
+    std::string_view operator[](size_t i) const { return cells[i]; }
+
+    // Parse cell i as a number; false if it is missing or not entirely
+    // numeric (a trailing '\r' is allowed)
+    template <typename T>
+    bool get(size_t i, T& value) const {
+        if (i >= count) return false;
+        const char* end = cells[i].data() + cells[i].size();
+        if (end != cells[i].data() && end[-1] == '\r') --end;
+        auto result = std::from_chars(cells[i].data(), end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+private:
+    friend class CsvTokenizer;
+    std::string_view cells[MAX_CELLS];
+    size_t count = 0;
+};
+
+// Calls visit(row) for every line of the file and returns the number of
+// lines; 0 if the file is missing or empty. The file is memory-mapped (or
+// read in one go when small) and split with SIMD delimiter scanning where
+// the CPU has it, so no per-cell strings are built. If version is given it
+// receives the generation that was read.
+template <typename Visitor>
+size_t visitCSV(const std::string& filename, Visitor&& visit, SnapshotVersion* version = nullptr);
+
+// Rows formatted into a single buffer and written with one system call
+class CsvWriter {
+public:
+    CsvWriter& cell(std::string_view text);
+    CsvWriter& cell(long long value);
+    CsvWriter& cell(int value) { return cell(static_cast<long long>(value)); }
+    CsvWriter& cell(double value, int precision);
+    void endRow();
+
+    template <typename... Cells>
+    void row(const Cells&... cells) {
+        (cell(cells), ...);
+        endRow();
+    }
+
+    const std::string& data() const { return buffer; }
+    bool empty() const { return buffer.empty(); }
+    void clear() { buffer.clear(); at_row_start = true; }
+
+    // Atomically replace the file with the buffer (see replaceFile) /
+    // append the buffer to it
+    bool writeTo(const std::string& filename) const;
+    bool appendTo(const std::string& filename) const;
+
+private:
+    void separator();
+
+    std::string buffer;
+    bool at_row_start = true;
+};
+
+// Convenience wrappers that copy every cell into a string
 std::vector<std::vector<std::string>> readCSV(const std::string& filename);
 void appendCSV(const std::string& filename, const std::vector<std::string>& row);
 void writeCSV(const std::string& filename, const std::vector<std::vector<std::string>>& rows);
 
+// Implementation details of visitCSV
+
+class CsvTokenizer {
+public:
+    using RowCallback = void (*)(void* context, const CsvRow& row);
+    static size_t scanFile(const std::string& filename, RowCallback callback, void* context,
+                           SnapshotVersion* version);
+    static size_t scan(const char* data, size_t size, RowCallback callback, void* context);
+};
+
+template <typename Visitor>
+size_t visitCSV(const std::string& filename, Visitor&& visit, SnapshotVersion* version) {
+    using V = std::remove_reference_t<Visitor>;
+    return CsvTokenizer::scanFile(
+        filename, [](void* context, const CsvRow& row) { (*static_cast<V*>(context))(row); },
+        const_cast<void*>(static_cast<const void*>(&visit)), version);
+}
+
 #endif
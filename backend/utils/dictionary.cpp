@@ -0,0 +1,70 @@
+#include "dictionary.h"
+#include "snapshot.h"
+#include "logger.h"
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool NameDictionary::open(const std::string& dictionary_path) {
+    path = dictionary_path;
+    std::ifstream file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t start = 0;
+    for (size_t end; (end = contents.find('\n', start)) != std::string::npos; start = end + 1) {
+        names.emplace_back(contents, start, end - start);
+        ids.emplace(names.back(), static_cast<uint32_t>(names.size() - 1));
+    }
+
+    // A torn last name would otherwise be glued to the next one appended
+    if (start < contents.size()) {
+        LOG_WARN("Dropping unterminated name at the end of " << path);
+        if (::truncate(path.c_str(), static_cast<off_t>(start)) != 0) return false;
+    }
+    return true;
+}
+
+std::optional<uint32_t> NameDictionary::find(std::string_view name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(name);
+    if (it == ids.end()) return std::nullopt;
+    return it->second;
+}
+
+uint32_t NameDictionary::intern(std::string_view name) {
+    if (auto id = find(name)) return *id;
+    if (name.find('\n') != std::string_view::npos) return UINT32_MAX;  // would shift every later id
+
+    // Persist the name before any row refers to its id
+    if (!path.empty()) {
+        std::string line(name);
+        line += '\n';
+        int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return UINT32_MAX;
+        off_t end = ::lseek(fd, 0, SEEK_END);
+        bool ok = ::write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size()) && ::fsync(fd) == 0;
+        if (!ok && end >= 0 && ::ftruncate(fd, end) != 0) {
+            LOG_ERROR("Cannot cut a partial name off " << path);
+        }
+        ::close(fd);
+        if (ok && size() == 0) ok = syncPath(parentDirectory(path));  // the file may be new
+        if (!ok) return UINT32_MAX;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    names.emplace_back(name);
+    uint32_t id = static_cast<uint32_t>(names.size() - 1);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+std::string NameDictionary::name(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return id < names.size() ? names[id] : std::string();
+}
+
+size_t NameDictionary::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
@@ -0,0 +1,34 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <optional>
+#include <cstdint>
+
+// Names interned to dense ids and persisted one per line (a name's id is
+// its line number), for dictionary-encoded columns on disk. A name is
+// fsynced before its id is handed out, so stored rows never refer to an id
+// the file lacks; names containing a newline are refused, and open() cuts
+// off a torn last line so it cannot merge with the next name. One writer
+// interns; lookups may come from any thread.
+// A dictionary that was never opened keeps its names in memory only.
+class NameDictionary {
+public:
+    bool open(const std::string& path);
+    std::optional<uint32_t> find(std::string_view name) const;
+    uint32_t intern(std::string_view name);  // writer only; UINT32_MAX on failure
+    std::string name(uint32_t id) const;
+    size_t size() const;
+
+private:
+    std::string path;
+    mutable std::shared_mutex mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> ids;  // views into names
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+// Log-linear latency histogram in the style of HdrHistogram.
+//
+// Values below 128 are counted exactly; above that every power of two is
+// split into 64 equal sub-buckets, so any recorded value is reported to
+// within 1/64 (about 1.6%) over the whole uint64_t range in a fixed 30 KB.
+// Not thread-safe: keep one per thread and merge() them for reporting.
+class Histogram {
+public:
+    void record(uint64_t value) {
+        ++counts[indexOf(value)];
+        ++total;
+        sum += value;
+        if (value > max_value) max_value = value;
+        if (value < min_value) min_value = value;
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = std::max(max_value, other.max_value);
+        min_value = std::min(min_value, other.min_value);
+    }
+
+    void reset() { *this = Histogram(); }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return total ? max_value : 0; }
+    uint64_t min() const { return total ? min_value : 0; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Smallest value v such that `percent` of the samples are <= v, as the
+    // upper edge of its bucket (never above the largest value seen)
+    uint64_t percentile(double percent) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(upperEdge(i), max_value);
+        }
+        return max_value;
+    }
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 6;                    // 64 per power of two
+    static constexpr uint64_t EXACT = 2ull << SUB_BUCKET_BITS;   // 128 exact values
+    static constexpr size_t BUCKETS = EXACT + (64 - SUB_BUCKET_BITS - 1) * (1u << SUB_BUCKET_BITS);
+
+    static size_t indexOf(uint64_t value) {
+        if (value < EXACT) return static_cast<size_t>(value);
+        int exponent = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;  // >= 1
+        uint64_t mantissa = value >> exponent;                          // [64, 128)
+        return EXACT + (exponent - 1) * (1u << SUB_BUCKET_BITS) + (mantissa - (1u << SUB_BUCKET_BITS));
+    }
+
+    static uint64_t upperEdge(size_t index) {
+        if (index < EXACT) return index;
+        size_t offset = index - EXACT;
+        int exponent = static_cast<int>(offset >> SUB_BUCKET_BITS) + 1;
+        uint64_t mantissa = (offset & ((1u << SUB_BUCKET_BITS) - 1)) + (1u << SUB_BUCKET_BITS);
+        return ((mantissa + 1) << exponent) - 1;
+    }
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max_value = 0;
+    uint64_t min_value = UINT64_MAX;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "holdings_store.h"
+#include "csv.h"
+
+const std::string HOLDINGS_FILE = "db/holdings.csv";
+
+HoldingsStore::HoldingsStore(const std::string& filename) : filename(filename), shards(SHARDS) {
+    load();
+}
+
+HoldingsStore::Shard& HoldingsStore::shardFor(const std::string& username) {
+    return shards[std::hash<std::string>{}(username) % SHARDS];
+}
+
+const HoldingsStore::Shard& HoldingsStore::shardFor(const std::string& username) const {
+    return shards[std::hash<std::string>{}(username) % SHARDS];
+}
+
+void HoldingsStore::load() {
+    visitCSV(filename, [this](const CsvRow& row) {
+        int quantity;
+        if (!row.get(2, quantity)) return;  // skip malformed quantity
+        std::string username(row[0]);
+        shardFor(username).accounts[username][std::string(row[1])] = quantity;
+    });
+}
+
+std::optional<int> HoldingsStore::getQuantity(const std::string& username, const std::string& ticker) const {
+    const Shard& shard = shardFor(username);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto account = shard.accounts.find(username);
+    if (account == shard.accounts.end()) return std::nullopt;
+    auto position = account->second.find(ticker);
+    if (position == account->second.end()) return std::nullopt;
+    return position->second;
+}
+
+void HoldingsStore::setQuantity(const std::string& username, const std::string& ticker, int quantity) {
+    Shard& shard = shardFor(username);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.accounts[username][ticker] = quantity;
+}
+
+std::vector<std::pair<std::string, int>> HoldingsStore::getPositions(const std::string& username) const {
+    const Shard& shard = shardFor(username);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::vector<std::pair<std::string, int>> result;
+    auto account = shard.accounts.find(username);
+    if (account != shard.accounts.end()) {
+        result.assign(account->second.begin(), account->second.end());
+    }
+    return result;
+}
+
+HoldingsStore& holdingsStore() {
+    static HoldingsStore store(HOLDINGS_FILE);
+    return store;
+}
@@ -0,0 +1,58 @@
+#ifndef HOLDINGS_STORE_H
+#define HOLDINGS_STORE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <optional>
+#include <mutex>
+
+// Resident copy of holdings.csv, indexed by (user, ticker).
+// The file is loaded once at startup; after that the store is only
+// changed in memory; durability comes from the trade log in
+// TransactionManager, which checkpoints back into holdings.csv.
+// Accounts are split over SHARDS maps by username, each with its own
+// mutex, so trades by different users do not contend here.
+class HoldingsStore {
+public:
+    explicit HoldingsStore(const std::string& filename);
+
+    std::optional<int> getQuantity(const std::string& username, const std::string& ticker) const;
+    void setQuantity(const std::string& username, const std::string& ticker, int quantity);
+
+    // Positions of one user as (ticker, quantity), ordered by ticker
+    std::vector<std::pair<std::string, int>> getPositions(const std::string& username) const;
+
+    // Call visit(username, ticker, quantity) for every position, one shard
+    // at a time under its lock; an account's positions come together
+    template <typename Visitor>
+    void forEachPosition(Visitor&& visit) const {
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& account : shard.accounts) {
+                for (const auto& position : account.second) visit(account.first, position.first, position.second);
+            }
+        }
+    }
+
+private:
+    void load();
+
+    static const size_t SHARDS = 64;
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::map<std::string, int>> accounts;
+    };
+    Shard& shardFor(const std::string& username);
+    const Shard& shardFor(const std::string& username) const;
+
+    const std::string filename;
+    std::vector<Shard> shards;
+};
+
+// Process-wide store backed by db/holdings.csv
+HoldingsStore& holdingsStore();
+
+#endif
@@ -0,0 +1,251 @@
+#include "http_parser.h"
+#include <cstring>
+#include <charconv>
+
+namespace {
+
+char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (lower(a[i]) != lower(b[i])) return false;
+    }
+    return true;
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.size() > haystack.size()) return false;
+    for (size_t i = 0; i + needle.size() <= haystack.size(); ++i) {
+        if (equalsIgnoreCase(haystack.substr(i, needle.size()), needle)) return true;
+    }
+    return false;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+const char* statusText(int status) {
+    switch (status) {
+        case 400: return "Bad Request";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default:  return "Error";
+    }
+}
+
+// Longest method we accept ("OPTIONS") plus the space after it
+const size_t MAX_METHOD_TOKEN = 8;
+
+const std::string_view HTTP_METHODS[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE",
+                                         "PATCH"};
+
+// True if token (upper-case letters only) may still grow into an HTTP
+// method; a raw command such as "METRICS" cannot, and is answered at once
+bool couldBeMethod(std::string_view token) {
+    for (std::string_view method : HTTP_METHODS) {
+        if (method.compare(0, token.size(), token) == 0) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < header_count; ++i) {
+        if (equalsIgnoreCase(headerName(i), name)) return headerValue(i);
+    }
+    return std::string_view();
+}
+
+std::string_view HttpRequest::cookie(std::string_view name) const {
+    if (cookie_index < 0) return std::string_view();
+    std::string_view cookies = headerValue(cookie_index);
+
+    while (!cookies.empty()) {
+        size_t semicolon = cookies.find(';');
+        std::string_view pair = trim(cookies.substr(0, semicolon));
+        size_t equals = pair.find('=');
+        if (equals != std::string_view::npos && pair.substr(0, equals) == name) {
+            return pair.substr(equals + 1);
+        }
+        if (semicolon == std::string_view::npos) break;
+        cookies.remove_prefix(semicolon + 1);
+    }
+    return std::string_view();
+}
+
+std::string_view HttpRequest::command() const {
+    if (raw) return body();
+    if (method() == "GET") {
+        std::string_view path = target();
+        if (!path.empty() && path.front() == '/') path.remove_prefix(1);
+        return path;
+    }
+    if (method() == "POST") return body();
+    return std::string_view();
+}
+
+HttpParser::HttpParser(const HttpLimits& limits) : limits(limits) {
+    if (this->limits.max_headers > HttpRequest::MAX_HEADERS) {
+        this->limits.max_headers = HttpRequest::MAX_HEADERS;
+    }
+}
+
+void HttpParser::reset() {
+    // Field by field: the header table is only read up to header_count
+    req.method_span = req.target_span = req.version_span = req.body_span = HttpRequest::Span();
+    req.header_count = 0;
+    req.cookie_index = -1;
+    req.raw = false;
+    req.keep_alive = false;
+    req.total_size = 0;
+    state = State::RequestLine;
+    line_start = 0;
+    scan_pos = 0;
+    body_start = 0;
+    content_length = 0;
+    error_status = 0;
+}
+
+HttpParser::Status HttpParser::fail(int status) {
+    error_status = status;
+    return Status::Error;
+}
+
+HttpParser::Status HttpParser::parse(std::string_view data) {
+    if (error_status != 0) return Status::Error;
+    req.base = data.data();
+
+    if (state == State::RequestLine && scan_pos == 0) {
+        // An HTTP request starts with an upper-case method and a space;
+        // anything else is a raw pipe command such as "GET_MARKET"
+        size_t i = 0;
+        while (i < data.size() && i < MAX_METHOD_TOKEN && data[i] >= 'A' && data[i] <= 'Z') ++i;
+        if (i == data.size() && i < MAX_METHOD_TOKEN && couldBeMethod(data)) return Status::Incomplete;
+        if (i == 0 || i == data.size() || data[i] != ' ') {
+            req.raw = true;
+            req.body_span = {0, static_cast<uint32_t>(data.size())};
+            req.total_size = data.size();
+            state = State::Done;
+            return Status::Complete;
+        }
+    }
+
+    while (state == State::RequestLine || state == State::Headers) {
+        const void* found = std::memchr(data.data() + scan_pos, '\n', data.size() - scan_pos);
+        if (!found) {
+            scan_pos = data.size();
+            if (state == State::RequestLine && data.size() > limits.max_request_line) return fail(414);
+            if (state == State::Headers && data.size() > limits.max_request_line + limits.max_header_bytes) {
+                return fail(431);
+            }
+            return Status::Incomplete;
+        }
+
+        size_t newline = static_cast<const char*>(found) - data.data();
+        size_t end = (newline > line_start && data[newline - 1] == '\r') ? newline - 1 : newline;
+
+        if (state == State::RequestLine) {
+            if (end > limits.max_request_line) return fail(414);
+            if (!parseRequestLine(data, end)) return fail(400);
+            state = State::Headers;
+        } else if (end == line_start) {
+            body_start = newline + 1;
+            if (content_length > limits.max_body) return fail(413);
+            state = State::Body;
+        } else {
+            if (req.header_count >= limits.max_headers) return fail(431);
+            if (!parseHeader(data, line_start, end)) return fail(error_status ? error_status : 400);
+        }
+
+        line_start = scan_pos = newline + 1;
+        if (line_start > limits.max_request_line + limits.max_header_bytes) return fail(431);
+    }
+
+    if (state == State::Body) {
+        if (data.size() - body_start < content_length) return Status::Incomplete;
+        req.body_span = {static_cast<uint32_t>(body_start), static_cast<uint32_t>(content_length)};
+        req.total_size = body_start + content_length;
+        state = State::Done;
+    }
+    return Status::Complete;
+}
+
+bool HttpParser::parseRequestLine(std::string_view data, size_t end) {
+    std::string_view line = data.substr(0, end);
+    size_t first = line.find(' ');
+    size_t last = line.rfind(' ');
+    if (first == std::string_view::npos || first == last) return false;
+
+    req.method_span = {0, static_cast<uint32_t>(first)};
+    req.target_span = {static_cast<uint32_t>(first + 1), static_cast<uint32_t>(last - first - 1)};
+    req.version_span = {static_cast<uint32_t>(last + 1), static_cast<uint32_t>(end - last - 1)};
+
+    std::string_view version = req.version();
+    if (version.substr(0, 7) != "HTTP/1.") return false;
+    req.keep_alive = version == "HTTP/1.1";
+    return true;
+}
+
+bool HttpParser::parseHeader(std::string_view data, size_t begin, size_t end) {
+    // Header names are short, so a plain loop beats a library search here
+    const char* line = data.data() + begin;
+    size_t length = end - begin;
+    size_t colon = 0;
+    while (colon < length && line[colon] != ':') ++colon;
+    if (colon == length || colon == 0) return false;
+
+    std::string_view name(line, colon);
+    std::string_view value = trim(std::string_view(line + colon + 1, length - colon - 1));
+
+    HttpRequest::Header& header = req.headers[req.header_count];
+    header.name = {static_cast<uint32_t>(begin), static_cast<uint32_t>(colon)};
+    header.value = {static_cast<uint32_t>(value.data() - data.data()), static_cast<uint32_t>(value.size())};
+
+    // Only a few headers matter here; the length check skips the rest cheaply
+    switch (name.size()) {
+        case 14:
+            if (equalsIgnoreCase(name, "Content-Length")) {
+                auto result = std::from_chars(value.data(), value.data() + value.size(), content_length);
+                if (result.ec != std::errc() || result.ptr != value.data() + value.size()) return false;
+            }
+            break;
+        case 10:
+            if (equalsIgnoreCase(name, "Connection")) {
+                if (containsIgnoreCase(value, "close")) req.keep_alive = false;
+                else if (containsIgnoreCase(value, "keep-alive")) req.keep_alive = true;
+            }
+            break;
+        case 6:
+            if (equalsIgnoreCase(name, "Cookie") && req.cookie_index < 0) {
+                req.cookie_index = static_cast<int>(req.header_count);
+            }
+            break;
+        case 17:
+            if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+                error_status = 501;  // chunked bodies are not supported
+                return false;
+            }
+            break;
+    }
+
+    ++req.header_count;
+    return true;
+}
+
+std::string httpErrorResponse(int status) {
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+    if (status == 503) response += "Retry-After: 1\r\n";
+    response += "Connection: close\r\n";
+    response += "Content-Length: 0\r\n\r\n";
+    return response;
+}
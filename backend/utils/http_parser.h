@@ -0,0 +1,119 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Size limits applied while parsing; requests over a limit are rejected
+// with the matching HTTP status instead of being truncated or buffered.
+struct HttpLimits {
+    size_t max_request_line = 8192;     // 414 URI Too Long
+    size_t max_header_bytes = 16384;    // 431 Request Header Fields Too Large
+    size_t max_headers = 32;            // 431 (at most HttpRequest::MAX_HEADERS)
+    size_t max_body = 1 << 20;          // 413 Payload Too Large
+};
+
+// A parsed request. Every field is a view into the buffer the request was
+// parsed from (stored as offsets, so the request can be moved to a copy of
+// that buffer with rebind()). Nothing here allocates.
+class HttpRequest {
+public:
+    static const size_t MAX_HEADERS = 32;
+
+    std::string_view method() const { return view(method_span); }
+    std::string_view target() const { return view(target_span); }
+    std::string_view version() const { return view(version_span); }
+    std::string_view body() const { return view(body_span); }
+
+    size_t headerCount() const { return header_count; }
+    std::string_view headerName(size_t i) const { return view(headers[i].name); }
+    std::string_view headerValue(size_t i) const { return view(headers[i].value); }
+    // Value of the first header with this name (case-insensitive), or empty
+    std::string_view header(std::string_view name) const;
+
+    // Value of one cookie from the Cookie header, or empty
+    std::string_view cookie(std::string_view name) const;
+
+    // The pipe command carried by the request: the target of a GET (without
+    // the leading '/'), the body of a POST, or the whole input for a raw
+    // command sent without HTTP framing.
+    std::string_view command() const;
+
+    bool isRaw() const { return raw; }
+    bool keepAlive() const { return keep_alive; }
+    size_t size() const { return total_size; }  // bytes the request occupies
+
+    // Point the views at another buffer holding the same bytes
+    void rebind(const char* new_base) { base = new_base; }
+
+private:
+    friend class HttpParser;
+
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    struct Header {
+        Span name;
+        Span value;
+    };
+
+    std::string_view view(Span span) const { return std::string_view(base + span.offset, span.length); }
+
+    const char* base = nullptr;
+    Span method_span, target_span, version_span, body_span;
+    Header headers[MAX_HEADERS];
+    size_t header_count = 0;
+    int cookie_index = -1;
+    bool raw = false;
+    bool keep_alive = false;
+    size_t total_size = 0;
+};
+
+// Incremental HTTP/1.x request parser.
+//
+// parse() is called with everything buffered for the current request each
+// time more bytes arrive; it resumes from where it stopped, so each byte is
+// scanned once no matter how the request is split across reads. Input that
+// does not start with an HTTP method is a raw pipe command and is taken as
+// a whole.
+class HttpParser {
+public:
+    enum class Status { Incomplete, Complete, Error };
+
+    explicit HttpParser(const HttpLimits& limits = HttpLimits());
+
+    Status parse(std::string_view data);
+
+    // Valid after parse() returned Complete; views point into its data
+    const HttpRequest& request() const { return req; }
+
+    // HTTP status to answer with after parse() returned Error
+    int errorStatus() const { return error_status; }
+
+    // Start over for the next request on the same connection
+    void reset();
+
+private:
+    enum class State { RequestLine, Headers, Body, Done };
+
+    Status fail(int status);
+    bool parseRequestLine(std::string_view data, size_t end);
+    bool parseHeader(std::string_view data, size_t begin, size_t end);
+
+    HttpLimits limits;
+    HttpRequest req;
+    State state = State::RequestLine;
+    size_t line_start = 0;     // start of the line being scanned
+    size_t scan_pos = 0;       // bytes before this were already searched
+    size_t body_start = 0;
+    size_t content_length = 0;
+    int error_status = 0;
+};
+
+// Minimal response for a request the parser rejected
+std::string httpErrorResponse(int status);
+
+#endif
@@ -0,0 +1,207 @@
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+// Lines longer than this are truncated
+const size_t MAX_LINE = 240;
+// Lines a thread can have queued before new ones are dropped (power of two)
+const size_t RING_SLOTS = 256;
+const auto FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+const char* LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+struct Entry {
+    int level;
+    uint32_t length;
+    std::chrono::system_clock::time_point time;
+    char text[MAX_LINE];
+};
+
+// Single producer (the owning thread), single consumer (the flusher)
+struct Ring {
+    Entry entries[RING_SLOTS];
+    alignas(64) std::atomic<uint64_t> head{0};   // next slot to write
+    alignas(64) std::atomic<uint64_t> tail{0};   // next slot to read
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> in_use{false};  // owned by a live thread
+};
+
+// Hands the ring back for reuse when its thread exits, so a server that
+// starts a thread per connection doesn't accumulate rings
+struct RingLease {
+    Ring* ring = nullptr;
+    ~RingLease() {
+        if (ring) ring->in_use.store(false, std::memory_order_release);
+    }
+};
+
+int levelFromEnvironment() {
+    const char* value = std::getenv("LOG_LEVEL");
+    if (!value) return LOG_LEVEL_INFO;
+    for (int level = LOG_LEVEL_DEBUG; level <= LOG_LEVEL_ERROR; ++level) {
+        if (strcasecmp(value, LEVEL_NAMES[level]) == 0) return level;
+    }
+    if (strcasecmp(value, "warning") == 0) return LOG_LEVEL_WARN;
+    return LOG_LEVEL_INFO;
+}
+
+class Logger {
+public:
+    Logger() : min_level(levelFromEnvironment()), flusher([this] { flusherLoop(); }) {
+        flusher.detach();
+    }
+
+    int level() const { return min_level; }
+
+    Ring& threadRing() {
+        thread_local RingLease lease;
+        if (!lease.ring) lease.ring = claimRing();
+        return *lease.ring;
+    }
+
+    void push(int level, const std::string& text) {
+        Ring& ring = threadRing();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Entry& entry = ring.entries[head % RING_SLOTS];
+        entry.level = level;
+        entry.time = std::chrono::system_clock::now();
+        entry.length = static_cast<uint32_t>(std::min(text.size(), MAX_LINE));
+        std::memcpy(entry.text, text.data(), entry.length);
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void flushNow() {
+        std::lock_guard<std::mutex> lock(drain_mutex);
+        drain();
+    }
+
+private:
+    Ring* claimRing() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& ring : rings) {
+            if (!ring->in_use.load(std::memory_order_acquire)) {
+                ring->in_use.store(true, std::memory_order_relaxed);
+                return ring.get();
+            }
+        }
+        rings.push_back(std::make_unique<Ring>());
+        rings.back()->in_use.store(true, std::memory_order_relaxed);
+        return rings.back().get();
+    }
+
+    void flusherLoop() {
+        for (;;) {
+            std::this_thread::sleep_for(FLUSH_INTERVAL);
+            flushNow();
+        }
+    }
+
+    // Move every queued line into two buffers, then write each once
+    void drain() {
+        std::vector<Ring*> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& ring : rings) snapshot.push_back(ring.get());
+        }
+
+        std::string out, err;
+        for (Ring* ring : snapshot) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (; tail != head; ++tail) {
+                const Entry& entry = ring->entries[tail % RING_SLOTS];
+                std::string& target = entry.level >= LOG_LEVEL_WARN ? err : out;
+                appendLine(target, entry);
+            }
+            ring->tail.store(tail, std::memory_order_release);
+
+            uint64_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                err += "[logger] dropped " + std::to_string(dropped) + " lines from a busy thread\n";
+            }
+        }
+        writeAll(STDOUT_FILENO, out);
+        writeAll(STDERR_FILENO, err);
+    }
+
+    static void appendLine(std::string& target, const Entry& entry) {
+        auto since_epoch = entry.time.time_since_epoch();
+        std::time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+        int millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+        std::tm utc;
+        gmtime_r(&seconds, &utc);
+        char stamp[64];
+        std::snprintf(stamp, sizeof(stamp), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %-5s ",
+                      utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+                      millis, LEVEL_NAMES[entry.level]);
+        target += stamp;
+        target.append(entry.text, entry.length);
+        target += '\n';
+    }
+
+    static void writeAll(int fd, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            written += n;
+        }
+    }
+
+    const int min_level;
+    std::mutex mutex;        // guards rings
+    std::mutex drain_mutex;  // one drain at a time
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::thread flusher;
+};
+
+// Never destroyed: worker threads may still log while statics are torn
+// down. Whatever is queued at exit is written by the atexit hook.
+Logger& instance() {
+    static Logger* logger = [] {
+        auto* created = new Logger;
+        std::atexit([] { instance().flushNow(); });
+        return created;
+    }();
+    return *logger;
+}
+
+}  // namespace
+
+namespace logger {
+
+bool enabled(int level) {
+    return level >= instance().level();
+}
+
+Line::Line(int level) : level(level), out([]() -> std::ostringstream& {
+    thread_local std::ostringstream stream;
+    stream.str(std::string());
+    stream.clear();
+    return stream;
+}()) {}
+
+Line::~Line() {
+    instance().push(level, out.str());
+}
+
+void flush() {
+    instance().flushNow();
+}
+
+}  // namespace logger
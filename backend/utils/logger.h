@@ -0,0 +1,92 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <sstream>
+#include <string>
+#include <cstdint>
+
+// Asynchronous logger.
+//
+// A log statement formats its line on the calling thread and pushes it
+// into that thread's own single-producer ring, with no lock and no system
+// call. A background thread drains every ring a few times per second and
+// writes each batch with one write() (INFO and DEBUG to stdout, WARN and
+// ERROR to stderr). If a ring is full the line is dropped and counted
+// rather than making the request wait.
+//
+//   LOG_INFO("Server listening on port " << port);
+//   LOG_SAMPLED(LOG_LEVEL_WARN, 100, "Shed request from " << ip);  // 1 in 100
+//
+// The runtime level comes from the LOG_LEVEL environment variable
+// (debug, info, warn, error; default info). Statements below
+// LOG_COMPILED_LEVEL are removed at compile time; LOG_DEBUG is compiled
+// out unless the build defines LOG_COMPILED_LEVEL=0.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_INFO
+#endif
+
+namespace logger {
+
+bool enabled(int level);
+
+// Collects one line and queues it when destroyed
+class Line {
+public:
+    explicit Line(int level);
+    ~Line();
+    std::ostream& stream() { return out; }
+
+private:
+    int level;
+    std::ostringstream& out;
+};
+
+// Write out everything queued so far (e.g. before exiting)
+void flush();
+
+}  // namespace logger
+
+#define LOG_AT(level, message)                          \
+    do {                                                \
+        if (logger::enabled(level)) {                   \
+            logger::Line log_line_(level);              \
+            log_line_.stream() << message;              \
+        }                                               \
+    } while (0)
+
+// Log only every `every`-th time this statement runs on a thread
+#define LOG_SAMPLED(level, every, message)                              \
+    do {                                                                \
+        static thread_local uint64_t log_sample_count_ = 0;             \
+        if (level >= LOG_COMPILED_LEVEL && log_sample_count_++ % (every) == 0) { \
+            LOG_AT(level, message);                                     \
+        }                                                               \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(message) LOG_AT(LOG_LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(message) do {} while (0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(message) LOG_AT(LOG_LEVEL_INFO, message)
+#else
+#define LOG_INFO(message) do {} while (0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(message) LOG_AT(LOG_LEVEL_WARN, message)
+#else
+#define LOG_WARN(message) do {} while (0)
+#endif
+
+#define LOG_ERROR(message) LOG_AT(LOG_LEVEL_ERROR, message)
+
+#endif
@@ -0,0 +1,260 @@
+#include "market_feed.h"
+#include "csv.h"
+#include "logger.h"
+#include "metrics.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Idle polls of the queue before the ingester starts sleeping, and how long
+const int IDLE_SPINS = 1000;
+const auto IDLE_SLEEP = std::chrono::microseconds(50);
+// Most updates taken off the queue per publish, to bound a batch's delay
+const size_t MAX_BATCH = 1 << 14;
+
+namespace {
+
+const Counter& updatesReceived() {
+    static const Counter counter("server_feed_updates_total", "", "Price updates queued by feed sources");
+    return counter;
+}
+
+const Counter& pricesApplied() {
+    static const Counter counter("server_feed_prices_applied_total", "",
+                                 "Price changes published after coalescing per ticker");
+    return counter;
+}
+
+const Counter& batchesPublished() {
+    static const Counter counter("server_feed_batches_total", "", "Quote table generations published by the feed");
+    return counter;
+}
+
+const LatencyHistogram& feedLatency() {
+    static const LatencyHistogram histogram("server_feed_latency_seconds", "",
+                                            "Time from a price's arrival to its publication");
+    return histogram;
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc();
+}
+
+}  // namespace
+
+ReplaySource::ReplaySource(const std::string& filename, double speed) : filename(filename), speed(speed) {
+    visitCSV(filename, [this](const CsvRow& row) {
+        Row r;
+        if (!row.get(0, r.offset_ms) || !row.get(2, r.price)) return;
+        r.ticker = row[1];
+        rows.push_back(std::move(r));
+    });
+}
+
+std::string ReplaySource::name() const {
+    return "replay:" + filename;
+}
+
+void ReplaySource::run(FeedSink& sink) {
+    if (rows.empty()) {
+        LOG_WARN("Replay feed " << filename << " has no rows");
+        return;
+    }
+    while (!sink.stopping()) {
+        auto start = std::chrono::steady_clock::now();
+        for (const Row& row : rows) {
+            if (speed > 0) {
+                auto due = start + std::chrono::microseconds(static_cast<int64_t>(row.offset_ms * 1000 / speed));
+                // Sleep in short steps so stop() is not held up by a long gap
+                while (!sink.stopping() && std::chrono::steady_clock::now() < due) {
+                    std::this_thread::sleep_until(std::min(due, std::chrono::steady_clock::now() +
+                                                                    std::chrono::milliseconds(100)));
+                }
+            }
+            if (!sink.publish(row.ticker, row.price) && sink.stopping()) return;
+        }
+    }
+}
+
+#ifdef __linux__
+std::string UdpSource::name() const {
+    return "udp:" + std::to_string(port);
+}
+
+void UdpSource::run(FeedSink& sink) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        LOG_ERROR("Feed cannot listen on UDP port " << port << ": " << strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    timeval timeout{0, 200000};  // wake up to notice stop()
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char buffer[65536];
+    while (!sink.stopping()) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) continue;
+        std::string_view datagram(buffer, static_cast<size_t>(n));
+        while (!datagram.empty()) {
+            size_t end = datagram.find('\n');
+            std::string_view line = datagram.substr(0, end);
+            datagram.remove_prefix(end == std::string_view::npos ? datagram.size() : end + 1);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            size_t comma = line.find(',');
+            double price;
+            if (comma == std::string_view::npos || !parseDouble(line.substr(comma + 1), price)) continue;
+            sink.publish(line.substr(0, comma), price);
+        }
+    }
+    close(fd);
+}
+#endif
+
+MarketFeed::MarketFeed(QuoteTable& quotes, size_t capacity) : quotes(quotes), queue(capacity) {}
+
+MarketFeed::~MarketFeed() {
+    stop();
+}
+
+bool MarketFeed::addSource(const std::string& spec) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string argument = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if (kind == "replay" && !argument.empty()) {
+        double speed = 1;
+        size_t last = argument.rfind(':');
+        if (last != std::string::npos && parseDouble(argument.substr(last + 1), speed)) {
+            argument.resize(last);
+        }
+        addSource(std::make_unique<ReplaySource>(argument, speed));
+        return true;
+    }
+#ifdef __linux__
+    int port = 0;
+    if (kind == "udp" && std::from_chars(argument.data(), argument.data() + argument.size(), port).ec == std::errc() &&
+        port > 0 && port < 65536) {
+        addSource(std::make_unique<UdpSource>(port));
+        return true;
+    }
+#endif
+    LOG_ERROR("Unknown market feed source: " << spec);
+    return false;
+}
+
+void MarketFeed::addSource(std::unique_ptr<FeedSource> source) {
+    sources.push_back(std::move(source));
+}
+
+void MarketFeed::start() {
+    if (started) return;
+    started = true;
+    threads.emplace_back([this] { ingestLoop(); });
+    for (auto& source : sources) {
+        LOG_INFO("Market feed source " << source->name());
+        FeedSource* s = source.get();
+        threads.emplace_back([this, s] { s->run(*this); });
+    }
+}
+
+void MarketFeed::stop() {
+    stop_flag = true;
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+}
+
+bool MarketFeed::publish(std::string_view ticker, double price) {
+    if (ticker.empty() || ticker.size() > FeedUpdate::MAX_TICKER || !(price > 0) || !std::isfinite(price)) {
+        return false;
+    }
+    FeedUpdate update;
+    std::memcpy(update.ticker, ticker.data(), ticker.size());
+    update.length = static_cast<uint8_t>(ticker.size());
+    update.price = price;
+    update.received = std::chrono::steady_clock::now();
+    while (!queue.push(update)) {
+        if (stopping()) return false;
+        std::this_thread::yield();
+    }
+    updatesReceived().add();
+    return true;
+}
+
+void MarketFeed::ingestLoop() {
+    int idle = 0;
+    while (!stopping()) {
+        if (drain() == 0) {
+            if (++idle < IDLE_SPINS) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(IDLE_SLEEP);
+            }
+            continue;
+        }
+        idle = 0;
+        apply();
+    }
+}
+
+// Move queued updates into the per-ticker latest slots
+size_t MarketFeed::drain() {
+    FeedUpdate update;
+    size_t taken = 0;
+    while (taken < MAX_BATCH && queue.pop(update)) {
+        ++taken;
+        std::string ticker(update.ticker, update.length);
+        auto it = slot_of_ticker.find(ticker);
+        if (it == slot_of_ticker.end()) {
+            it = slot_of_ticker.emplace(std::move(ticker), static_cast<uint32_t>(latest.size())).first;
+            latest.emplace_back();
+            latest.back().length = 0;  // not pending
+        }
+        FeedUpdate& slot = latest[it->second];
+        if (slot.length == 0) {
+            dirty.push_back(it->second);
+            slot = update;
+        } else {
+            // Keep the first arrival time so latency covers the whole wait
+            auto first = slot.received;
+            slot = update;
+            slot.received = first;
+        }
+    }
+    return taken;
+}
+
+void MarketFeed::apply() {
+    changes.clear();
+    for (uint32_t slot : dirty) {
+        const FeedUpdate& update = latest[slot];
+        changes.push_back({std::string(update.ticker, update.length), update.price});
+    }
+    size_t applied = quotes.applyPrices(changes);
+
+    auto now = std::chrono::steady_clock::now();
+    for (uint32_t slot : dirty) {
+        feedLatency().observe(now - latest[slot].received);
+        latest[slot].length = 0;
+    }
+    dirty.clear();
+    pricesApplied().add(applied);
+    if (applied > 0) batchesPublished().add();
+}
+
+MarketFeed& marketFeed() {
+    static MarketFeed feed(quoteTable());
+    return feed;
+}
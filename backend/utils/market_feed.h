@@ -0,0 +1,132 @@
+#ifndef MARKET_FEED_H
+#define MARKET_FEED_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "mpsc_queue.h"
+#include "quote_table.h"
+
+// One price as a source delivered it
+struct FeedUpdate {
+    static const size_t MAX_TICKER = 15;
+    char ticker[MAX_TICKER];
+    uint8_t length = 0;
+    double price = 0;
+    std::chrono::steady_clock::time_point received;
+};
+
+// Where sources deliver prices; publish may be called from any thread
+class FeedSink {
+public:
+    virtual ~FeedSink() = default;
+    // Queue one price; false if it is invalid or the feed is stopping
+    virtual bool publish(std::string_view ticker, double price) = 0;
+    virtual bool stopping() const = 0;
+};
+
+// A market data source. run() is called on a thread of its own and should
+// return once sink.stopping() turns true (or when the source ends).
+class FeedSource {
+public:
+    virtual ~FeedSource() = default;
+    virtual std::string name() const = 0;
+    virtual void run(FeedSink& sink) = 0;
+};
+
+// Replays a recorded feed: rows of "offset_ms,ticker,price", offsets
+// relative to the start of the file. speed scales time (2 = twice as
+// fast, 0 = as fast as the queue takes them); the file repeats until the
+// feed stops.
+class ReplaySource : public FeedSource {
+public:
+    ReplaySource(const std::string& filename, double speed);
+    std::string name() const override;
+    void run(FeedSink& sink) override;
+
+private:
+    struct Row {
+        int64_t offset_ms;
+        std::string ticker;
+        double price;
+    };
+    std::string filename;
+    double speed;
+    std::vector<Row> rows;
+};
+
+#ifdef __linux__
+// Datagrams of "ticker,price" lines received on a loopback UDP port, for
+// fetchers running outside the server (market_updater.py --feed)
+class UdpSource : public FeedSource {
+public:
+    explicit UdpSource(int port) : port(port) {}
+    std::string name() const override;
+    void run(FeedSink& sink) override;
+
+private:
+    int port;
+};
+#endif
+
+// In-process market data ingestion.
+//
+// Sources run on their own threads and push updates into one bounded
+// lock-free MPSC queue (a full queue makes them wait). A single ingester
+// thread drains it, keeps only the latest price per ticker (coalescing),
+// and publishes each drained batch into the QuoteTable as one generation,
+// which also drives the valuation re-marks and the market stream. The
+// longer a publish takes, the more updates the next batch coalesces, so a
+// burst costs one table copy rather than one per update.
+//
+// Feed prices are not written to market.csv; rewriting the file still
+// replaces the whole table, and the feed's next updates apply on top.
+class MarketFeed : public FeedSink {
+public:
+    static const size_t QUEUE_CAPACITY = 1 << 14;
+
+    explicit MarketFeed(QuoteTable& quotes, size_t capacity = QUEUE_CAPACITY);
+    ~MarketFeed() override;
+
+    // Add a source before start(). spec is "replay:file[:speed]" or
+    // "udp:port"; false (and logged) if it cannot be used.
+    bool addSource(const std::string& spec);
+    void addSource(std::unique_ptr<FeedSource> source);
+
+    // Start the ingester and every source (idempotent); stop joins them
+    void start();
+    void stop();
+
+    bool publish(std::string_view ticker, double price) override;
+    bool stopping() const override { return stop_flag.load(std::memory_order_relaxed); }
+
+private:
+    void ingestLoop();
+    size_t drain();
+    void apply();
+
+    QuoteTable& quotes;
+    MpscQueue<FeedUpdate> queue;
+    std::atomic<bool> stop_flag{false};
+    bool started = false;
+    std::vector<std::unique_ptr<FeedSource>> sources;
+    std::vector<std::thread> threads;  // ingester first, then one per source
+
+    // Latest update per ticker since the last publish (ingester thread only)
+    std::unordered_map<std::string, uint32_t> slot_of_ticker;
+    std::vector<FeedUpdate> latest;
+    std::vector<uint32_t> dirty;
+    std::vector<PriceChange> changes;
+};
+
+// Process-wide feed into quoteTable(); Server::start adds the sources
+// listed in MARKET_FEED (comma separated) and starts it
+MarketFeed& marketFeed();
+
+#endif
@@ -0,0 +1,176 @@
+#include "market_history.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+
+const std::string TICKS_DIRECTORY = "db/ticks";
+
+// How often buffered ticks are written to the log
+const auto TICK_FLUSH_PERIOD = std::chrono::seconds(1);
+
+const int64_t CandleStore::INTERVAL_MS[CandleStore::INTERVAL_COUNT] = {1000, 60 * 1000, 60 * 60 * 1000};
+// 15 minutes of 1s candles, a day of 1m candles, 90 days of 1h candles
+const int64_t CandleStore::RETENTION_MS[CandleStore::INTERVAL_COUNT] = {15 * 60 * 1000, 24 * 60 * 60 * 1000,
+                                                                        90LL * 24 * 60 * 60 * 1000};
+
+namespace {
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+CandleStore::Shard& CandleStore::shardFor(const std::string& ticker) {
+    return shards[std::hash<std::string>{}(ticker) % SHARDS];
+}
+
+const CandleStore::Shard& CandleStore::shardFor(const std::string& ticker) const {
+    return shards[std::hash<std::string>{}(ticker) % SHARDS];
+}
+
+Candle& CandleStore::bucket(Series& series, size_t i, int64_t time_ms, double open) {
+    std::deque<Candle>& buckets = series.buckets[i];
+    int64_t start = time_ms - time_ms % INTERVAL_MS[i];
+    // Almost always the newest bucket or a new one after it
+    if (buckets.empty() || buckets.back().start_ms < start) {
+        Candle candle;
+        candle.start_ms = start;
+        candle.open = candle.high = candle.low = candle.close = open;
+        buckets.push_back(candle);
+        while (buckets.front().start_ms < start - RETENTION_MS[i]) buckets.pop_front();
+        return buckets.back();
+    }
+    auto it = std::lower_bound(buckets.begin(), buckets.end(), start,
+                               [](const Candle& candle, int64_t t) { return candle.start_ms < t; });
+    if (it == buckets.end() || it->start_ms != start) {
+        Candle candle;
+        candle.start_ms = start;
+        candle.open = candle.high = candle.low = candle.close = open;
+        it = buckets.insert(it, candle);
+    }
+    return *it;
+}
+
+void CandleStore::onTick(const std::string& ticker, int64_t time_ms, double price) {
+    Shard& shard = shardFor(ticker);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Series& series = shard.series[ticker];
+    for (size_t i = 0; i < INTERVAL_COUNT; ++i) {
+        Candle& candle = bucket(series, i, time_ms, price);
+        candle.high = std::max(candle.high, price);
+        candle.low = std::min(candle.low, price);
+        candle.close = price;
+    }
+}
+
+void CandleStore::onTrade(const std::string& ticker, int64_t time_ms, int quantity, double price) {
+    Shard& shard = shardFor(ticker);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Series& series = shard.series[ticker];
+    const auto& newest = series.buckets[0];
+    double open = newest.empty() ? price : newest.back().close;
+    for (size_t i = 0; i < INTERVAL_COUNT; ++i) {
+        bucket(series, i, time_ms, open).volume += quantity;
+    }
+}
+
+bool CandleStore::candles(const std::string& ticker, int64_t interval_ms, int64_t from, int64_t to, size_t limit,
+                          std::vector<Candle>& result) const {
+    size_t i = std::find(INTERVAL_MS, INTERVAL_MS + INTERVAL_COUNT, interval_ms) - INTERVAL_MS;
+    if (i == INTERVAL_COUNT) return false;
+
+    const Shard& shard = shardFor(ticker);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.series.find(ticker);
+    if (it == shard.series.end()) return true;
+    const std::deque<Candle>& buckets = it->second.buckets[i];
+    auto begin = std::lower_bound(buckets.begin(), buckets.end(), from,
+                                  [](const Candle& candle, int64_t t) { return candle.start_ms < t; });
+    for (auto c = begin; c != buckets.end() && c->start_ms <= to && result.size() < limit; ++c) {
+        result.push_back(*c);
+    }
+    return true;
+}
+
+double CandleStore::lastClose(const std::string& ticker) const {
+    const Shard& shard = shardFor(ticker);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.series.find(ticker);
+    if (it == shard.series.end() || it->second.buckets[0].empty()) return 0;
+    return it->second.buckets[0].back().close;
+}
+
+MarketHistory::MarketHistory(const std::string& directory, QuoteTable& quotes, TransactionIndex& trades)
+    : ticks(directory, CandleStore::RETENTION_MS[CandleStore::INTERVAL_COUNT - 1]) {
+    if (!ticks.open()) LOG_ERROR("Cannot open tick store in " << directory);
+
+    // Rebuild the candles; older ticks and trades would be dropped anyway
+    int64_t oldest = nowMs() - CandleStore::RETENTION_MS[CandleStore::INTERVAL_COUNT - 1];
+    ticks.removeBefore(oldest);
+    size_t replayed = 0;
+    ticks.forEach(oldest, [&](const std::string& ticker, int64_t time_ms, double price) {
+        if (time_ms < oldest) return;
+        candle_store.onTick(ticker, time_ms, price);
+        ++replayed;
+    });
+    trades.forEachTrade(oldest, [this](const std::string& ticker, int64_t time_ms, int quantity, double price) {
+        candle_store.onTrade(ticker, time_ms, quantity, price);
+    });
+    LOG_INFO("Rebuilt candles from " << replayed << " ticks (" << ticks.bytes() << " bytes)");
+
+    // Prices that moved while the server was down start the series again
+    {
+        auto market = quotes.snapshot();
+        int64_t now = nowMs();
+        for (const auto& quote : market->quotes) {
+            if (candle_store.lastClose(quote.ticker) == quote.price) continue;
+            ticks.append(quote.ticker, now, quote.price);
+            candle_store.onTick(quote.ticker, now, quote.price);
+        }
+    }
+
+    quotes.addListener([this](const MarketSnapshot& previous, const MarketSnapshot& next) {
+        onPrices(previous, next);
+    });
+    trades.addListener([this](const std::string& ticker, int64_t time_ms, int quantity, double price) {
+        candle_store.onTrade(ticker, time_ms, quantity, price);
+    });
+    flusher = std::thread([this] { flushLoop(); });
+}
+
+MarketHistory::~MarketHistory() {
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex);
+        stopping = true;
+    }
+    flush_cv.notify_one();
+    if (flusher.joinable()) flusher.join();
+    ticks.flush();
+}
+
+void MarketHistory::onPrices(const MarketSnapshot& previous, const MarketSnapshot& next) {
+    int64_t now = nowMs();
+    forEachChangedQuote(next, [&](const Quote& quote) {
+        const Quote* before = previous.find(quote.ticker);
+        if (before && before->price == quote.price) return;
+        ticks.append(quote.ticker, now, quote.price);
+        candle_store.onTick(quote.ticker, now, quote.price);
+    });
+}
+
+void MarketHistory::flushLoop() {
+    std::unique_lock<std::mutex> lock(flush_mutex);
+    while (!stopping) {
+        flush_cv.wait_for(lock, TICK_FLUSH_PERIOD, [this] { return stopping; });
+        lock.unlock();
+        ticks.flush();
+        lock.lock();
+    }
+}
+
+MarketHistory& marketHistory() {
+    static MarketHistory history(TICKS_DIRECTORY, quoteTable(), transactionIndex());
+    return history;
+}
@@ -0,0 +1,97 @@
+#ifndef MARKET_HISTORY_H
+#define MARKET_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "tick_store.h"
+#include "quote_table.h"
+#include "transaction_index.h"
+
+// One OHLCV bucket
+struct Candle {
+    int64_t start_ms = 0;  // the bucket covers [start_ms, start_ms + interval)
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double close = 0;
+    long long volume = 0;  // shares traded on this server
+};
+
+// OHLCV candles per ticker at 1s, 1m and 1h, updated in place as ticks and
+// trades arrive. Prices come from the quote table's ticks and volume from
+// executed trades. Only buckets that saw a tick or a trade exist, so a
+// gap in the series is a period without either. Each interval keeps a
+// bounded span of history (RETENTION_MS); older buckets are dropped.
+class CandleStore {
+public:
+    static const size_t INTERVAL_COUNT = 3;
+    static const int64_t INTERVAL_MS[INTERVAL_COUNT];
+    static const int64_t RETENTION_MS[INTERVAL_COUNT];
+
+    void onTick(const std::string& ticker, int64_t time_ms, double price);
+    // Adds volume; a bucket without a tick yet opens at the last close
+    // (or at the trade's price if the ticker has no ticks)
+    void onTrade(const std::string& ticker, int64_t time_ms, int quantity, double price);
+
+    // Buckets of one interval starting within [from, to], oldest first,
+    // at most `limit`; false if the interval is not one of INTERVAL_MS
+    bool candles(const std::string& ticker, int64_t interval_ms, int64_t from, int64_t to, size_t limit,
+                 std::vector<Candle>& result) const;
+
+    // Last close of a ticker, or 0
+    double lastClose(const std::string& ticker) const;
+
+private:
+    struct Series {
+        std::deque<Candle> buckets[INTERVAL_COUNT];
+    };
+
+    static const size_t SHARDS = 64;
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Series> series;
+    };
+    Shard& shardFor(const std::string& ticker);
+    const Shard& shardFor(const std::string& ticker) const;
+
+    // The bucket of interval i covering time_ms, created if missing
+    static Candle& bucket(Series& series, size_t i, int64_t time_ms, double open);
+
+    Shard shards[SHARDS];
+};
+
+// Price history for charts: records every price change from the quote
+// table in a TickStore and keeps a CandleStore current from the ticks and
+// from the trades the index receives (each logged side counts, as in
+// VOLUME). At startup the candles are rebuilt from the tick
+// log and the trade store. A background thread writes buffered ticks to
+// the log once a second.
+class MarketHistory {
+public:
+    MarketHistory(const std::string& directory, QuoteTable& quotes, TransactionIndex& trades);
+    ~MarketHistory();
+
+    const CandleStore& candles() const { return candle_store; }
+
+private:
+    void onPrices(const MarketSnapshot& previous, const MarketSnapshot& next);
+    void flushLoop();
+
+    TickStore ticks;
+    CandleStore candle_store;
+    std::mutex flush_mutex;
+    std::condition_variable flush_cv;
+    bool stopping = false;
+    std::thread flusher;
+};
+
+// Process-wide history in db/ticks/ over quoteTable() and transactionIndex()
+MarketHistory& marketHistory();
+
+#endif
@@ -0,0 +1,176 @@
+#include "metrics.h"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <map>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// Room for this many of each kind; registering more is a programming error
+const size_t MAX_COUNTERS = 64;
+const size_t MAX_HISTOGRAMS = 96;
+// Bucket i counts durations up to 2^i microseconds; the last is +Inf
+const size_t BUCKETS = 26;
+
+struct HistogramCells {
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> count;
+};
+
+// One thread's metrics. Only that thread writes them.
+struct ThreadMetrics {
+    std::atomic<uint64_t> counters[MAX_COUNTERS] = {};
+    HistogramCells histograms[MAX_HISTOGRAMS] = {};
+};
+
+struct Descriptor {
+    std::string name;
+    std::string labels;
+    std::string help;
+    std::string type;
+    size_t id = 0;                    // slot in ThreadMetrics
+    std::function<double()> sample;   // sampled metrics only
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Descriptor> descriptors;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads;  // kept after a thread exits
+    size_t counters = 0;
+    size_t histograms = 0;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // outlives threads recording at exit
+    return *instance;
+}
+
+ThreadMetrics& threadMetrics() {
+    thread_local ThreadMetrics* metrics = [] {
+        auto owned = std::make_unique<ThreadMetrics>();
+        ThreadMetrics* raw = owned.get();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        registry().threads.push_back(std::move(owned));
+        return raw;
+    }();
+    return *metrics;
+}
+
+// Single-writer increment: no locked instruction needed
+void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+size_t bucketOf(uint64_t ns) {
+    uint64_t us = (ns + 999) / 1000;
+    if (us <= 1) return 0;
+    size_t bucket = 64 - __builtin_clzll(us - 1);  // ceil(log2(us))
+    return bucket < BUCKETS - 1 ? bucket : BUCKETS - 1;
+}
+
+size_t registerMetric(const std::string& name, const std::string& labels, const std::string& help,
+                      const std::string& type, std::function<double()> sample = nullptr) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Descriptor d{name, labels, help, type, 0, std::move(sample)};
+    if (type == "histogram") {
+        if (r.histograms == MAX_HISTOGRAMS) throw std::length_error("too many histograms");
+        d.id = r.histograms++;
+    } else if (!d.sample) {
+        if (r.counters == MAX_COUNTERS) throw std::length_error("too many counters");
+        d.id = r.counters++;
+    }
+    r.descriptors.push_back(std::move(d));
+    return r.descriptors.back().id;
+}
+
+std::string withLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string number(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    return text;
+}
+
+}  // namespace
+
+Counter::Counter(const std::string& name, const std::string& labels, const std::string& help)
+    : id(registerMetric(name, labels, help, "counter")) {}
+
+void Counter::add(uint64_t n) const {
+    bump(threadMetrics().counters[id], n);
+}
+
+LatencyHistogram::LatencyHistogram(const std::string& name, const std::string& labels, const std::string& help)
+    : id(registerMetric(name, labels, help, "histogram")) {}
+
+void LatencyHistogram::observe(std::chrono::steady_clock::duration elapsed) const {
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    HistogramCells& cells = threadMetrics().histograms[id];
+    bump(cells.buckets[bucketOf(ns)], 1);
+    bump(cells.sum_ns, ns);
+    bump(cells.count, 1);
+}
+
+void registerSampled(const std::string& name, const std::string& labels, const std::string& help,
+                     const std::string& type, std::function<double()> sample) {
+    registerMetric(name, labels, help, type, std::move(sample));
+}
+
+std::string renderMetrics() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // Group series by metric name, keeping registration order within each
+    std::map<std::string, std::vector<const Descriptor*>> families;
+    for (const auto& d : r.descriptors) families[d.name].push_back(&d);
+
+    std::string out;
+    for (const auto& family : families) {
+        // Help text only needs to be given by one series of the family
+        const Descriptor& first = *family.second.front();
+        std::string help;
+        for (const Descriptor* d : family.second) {
+            if (help.empty()) help = d->help;
+        }
+        out += "# HELP " + first.name + " " + help + "\n";
+        out += "# TYPE " + first.name + " " + first.type + "\n";
+
+        for (const Descriptor* d : family.second) {
+            if (d->sample) {
+                out += d->name + withLabels(d->labels, "") + " " + number(d->sample()) + "\n";
+            } else if (d->type == "counter") {
+                uint64_t total = 0;
+                for (const auto& t : r.threads) total += t->counters[d->id].load(std::memory_order_relaxed);
+                out += d->name + withLabels(d->labels, "") + " " + std::to_string(total) + "\n";
+            } else {
+                uint64_t buckets[BUCKETS] = {};
+                uint64_t sum_ns = 0, count = 0;
+                for (const auto& t : r.threads) {
+                    const HistogramCells& cells = t->histograms[d->id];
+                    for (size_t i = 0; i < BUCKETS; ++i) buckets[i] += cells.buckets[i].load(std::memory_order_relaxed);
+                    sum_ns += cells.sum_ns.load(std::memory_order_relaxed);
+                    count += cells.count.load(std::memory_order_relaxed);
+                }
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < BUCKETS; ++i) {
+                    cumulative += buckets[i];
+                    std::string le = i + 1 < BUCKETS ? number((1ull << i) * 1e-6) : "+Inf";
+                    out += d->name + "_bucket" + withLabels(d->labels, "le=\"" + le + "\"") + " " +
+                           std::to_string(cumulative) + "\n";
+                }
+                out += d->name + "_sum" + withLabels(d->labels, "") + " " + number(sum_ns * 1e-9) + "\n";
+                out += d->name + "_count" + withLabels(d->labels, "") + " " + std::to_string(count) + "\n";
+            }
+        }
+    }
+    return out;
+}
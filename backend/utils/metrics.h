@@ -0,0 +1,72 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+// Process metrics in Prometheus text format.
+//
+// Every thread that records gets its own block of counters and histogram
+// buckets, so recording is a relaxed load and store on memory no other
+// thread writes: no locks, no shared cache lines. renderMetrics() sums the
+// blocks of all threads when METRICS is scraped. Metric handles are
+// registered once (usually as function-local statics) and are cheap to
+// copy; registration is the only step that takes a lock.
+//
+// Histograms count durations in power-of-two buckets from 1us to ~16s.
+
+class Counter {
+public:
+    Counter(const std::string& name, const std::string& labels, const std::string& help);
+    void add(uint64_t n = 1) const;
+
+private:
+    size_t id;
+};
+
+class LatencyHistogram {
+public:
+    LatencyHistogram(const std::string& name, const std::string& labels, const std::string& help);
+    void observe(std::chrono::steady_clock::duration elapsed) const;
+
+private:
+    size_t id;
+};
+
+// A value read at scrape time, such as a queue depth; type is "gauge" or
+// "counter" (for totals that are already kept elsewhere)
+void registerSampled(const std::string& name, const std::string& labels, const std::string& help,
+                     const std::string& type, std::function<double()> sample);
+
+// Records the time from construction to destruction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram.observe(std::chrono::steady_clock::now() - start); }
+
+private:
+    const LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Lock m, recording how long the caller waited (zero when uncontended)
+template <typename Mutex>
+std::unique_lock<Mutex> lockTimed(Mutex& m, const LatencyHistogram& wait) {
+    if (m.try_lock()) {
+        wait.observe(std::chrono::steady_clock::duration::zero());
+        return std::unique_lock<Mutex>(m, std::adopt_lock);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<Mutex> lock(m);
+    wait.observe(std::chrono::steady_clock::now() - start);
+    return lock;
+}
+
+// Prometheus exposition of every registered metric
+std::string renderMetrics();
+
+#endif
@@ -0,0 +1,126 @@
+#include "order_book.h"
+
+// Levels a ladder starts with, and extra room added when it grows
+const int64_t INITIAL_SPAN = 4096;
+
+bool OrderBook::ensureLevel(Ladder& ladder, int64_t price) {
+    int64_t size = static_cast<int64_t>(ladder.levels.size());
+    if (size > 0 && price >= ladder.base && price < ladder.base + size) return true;
+
+    if (ladder.count == 0) {
+        // Nothing rests on this side; recentre a fresh window on the new price
+        ladder.levels.assign(static_cast<size_t>(INITIAL_SPAN), Level{});
+        ladder.base = price - INITIAL_SPAN / 2;
+        return true;
+    }
+
+    int64_t low = std::min(ladder.base, price);
+    int64_t high = std::max(ladder.base + size - 1, price);
+    if (high - low + 1 > MAX_SPAN) return false;
+    int64_t margin = std::max(high - low + 1, INITIAL_SPAN) / 2;
+    int64_t new_low = price < ladder.base ? low - margin : low;
+    int64_t new_high = price < ladder.base ? high : high + margin;
+    if (new_high - new_low + 1 > MAX_SPAN) {
+        if (price < ladder.base) new_low = new_high - MAX_SPAN + 1;
+        else new_high = new_low + MAX_SPAN - 1;
+    }
+
+    std::vector<Level> levels(static_cast<size_t>(new_high - new_low + 1));
+    int64_t shift = ladder.base - new_low;
+    std::copy(ladder.levels.begin(), ladder.levels.end(), levels.begin() + shift);
+    ladder.levels.swap(levels);
+    ladder.base = new_low;
+    ladder.best += shift;
+    return true;
+}
+
+// Release a grown window once its side has no orders left. Not called from
+// unlink, which runs while matching holds a reference into the levels.
+void OrderBook::shrinkIfEmpty(Ladder& ladder) {
+    if (ladder.count == 0 && static_cast<int64_t>(ladder.levels.size()) > INITIAL_SPAN) {
+        std::vector<Level>().swap(ladder.levels);
+    }
+}
+
+void OrderBook::append(Ladder& ladder, uint32_t slot) {
+    Order& order = pool[slot];
+    int64_t index = order.price - ladder.base;
+    Level& level = ladder.levels[static_cast<size_t>(index)];
+    order.prev = level.tail;
+    order.next = OrderPool::NONE;
+    if (level.tail != OrderPool::NONE) {
+        pool[level.tail].next = slot;
+    } else {
+        level.head = slot;
+        bool better = ladder.descending ? index > ladder.best : index < ladder.best;
+        if (ladder.count == 0 || better) ladder.best = index;
+        ++ladder.count;
+    }
+    level.tail = slot;
+    level.quantity += order.quantity;
+}
+
+void OrderBook::unlink(Ladder& ladder, uint32_t slot) {
+    Order& order = pool[slot];
+    int64_t index = order.price - ladder.base;
+    Level& level = ladder.levels[static_cast<size_t>(index)];
+    if (order.prev != OrderPool::NONE) pool[order.prev].next = order.next;
+    else level.head = order.next;
+    if (order.next != OrderPool::NONE) pool[order.next].prev = order.prev;
+    else level.tail = order.prev;
+
+    if (level.head == OrderPool::NONE) {
+        level.quantity = 0;
+        --ladder.count;
+        if (index == ladder.best && ladder.count > 0) advanceBest(ladder);
+    }
+}
+
+void OrderBook::advanceBest(Ladder& ladder) {
+    int64_t step = ladder.descending ? -1 : 1;
+    int64_t index = ladder.best + step;
+    while (ladder.levels[static_cast<size_t>(index)].head == OrderPool::NONE) index += step;
+    ladder.best = index;
+}
+
+uint32_t OrderBook::slotOf(uint64_t id) const {
+    uint32_t slot = static_cast<uint32_t>(id);
+    if (slot >= pool.capacity() || !pool[slot].live || pool[slot].id != id) return OrderPool::NONE;
+    return slot;
+}
+
+const Order* OrderBook::find(uint64_t id) const {
+    uint32_t slot = slotOf(id);
+    return slot == OrderPool::NONE ? nullptr : &pool[slot];
+}
+
+int32_t OrderBook::cancel(uint64_t id) {
+    uint32_t slot = slotOf(id);
+    if (slot == OrderPool::NONE) return 0;
+    Order& order = pool[slot];
+    Ladder& ladder = order.side == BUY ? bids : asks;
+    int32_t open = order.quantity;
+    ladder.levels[static_cast<size_t>(order.price - ladder.base)].quantity -= open;
+    unlink(ladder, slot);
+    pool.release(slot);
+    --open_orders;
+    shrinkIfEmpty(ladder);
+    return open;
+}
+
+bool OrderBook::reduce(uint64_t id, int32_t quantity) {
+    uint32_t slot = slotOf(id);
+    if (slot == OrderPool::NONE || quantity <= 0 || quantity > pool[slot].quantity) return false;
+    Order& order = pool[slot];
+    Ladder& ladder = order.side == BUY ? bids : asks;
+    ladder.levels[static_cast<size_t>(order.price - ladder.base)].quantity -= order.quantity - quantity;
+    order.quantity = quantity;
+    return true;
+}
+
+int64_t OrderBook::depthAt(Side side, int64_t price) const {
+    const Ladder& ladder = side == BUY ? bids : asks;
+    int64_t index = price - ladder.base;
+    if (index < 0 || index >= static_cast<int64_t>(ladder.levels.size())) return 0;
+    return ladder.levels[static_cast<size_t>(index)].quantity;
+}
@@ -0,0 +1,193 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// Fixed-size order records handed out by index from a free list, so the
+// book allocates only when the pool grows and orders of one price level
+// can be linked through their indexes (an intrusive list).
+struct Order {
+    uint64_t id = 0;        // generation << 32 | slot
+    int64_t price = 0;      // in ticks
+    int32_t quantity = 0;   // still open
+    uint32_t owner = 0;
+    uint32_t prev = 0;      // neighbours in the price level (NONE at the ends)
+    uint32_t next = 0;
+    uint8_t side = 0;
+    bool live = false;
+};
+
+class OrderPool {
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    uint32_t allocate() {
+        if (free_head == NONE) {
+            orders.emplace_back();
+            orders.back().next = NONE;
+            return static_cast<uint32_t>(orders.size() - 1);
+        }
+        uint32_t slot = free_head;
+        free_head = orders[slot].next;
+        return slot;
+    }
+
+    void release(uint32_t slot) {
+        orders[slot].live = false;
+        orders[slot].next = free_head;
+        free_head = slot;
+    }
+
+    Order& operator[](uint32_t slot) { return orders[slot]; }
+    const Order& operator[](uint32_t slot) const { return orders[slot]; }
+    size_t capacity() const { return orders.size(); }
+    void reserve(size_t count) { orders.reserve(count); }
+
+private:
+    std::vector<Order> orders;
+    uint32_t free_head = NONE;
+};
+
+// One match between an incoming order and a resting one, at the resting
+// order's price
+struct Fill {
+    uint64_t maker_id;
+    uint32_t maker_owner;
+    uint32_t taker_owner;
+    uint8_t taker_side;
+    int64_t price;
+    int32_t quantity;
+    bool maker_done;  // the resting order was filled completely
+};
+
+// Limit order book for one instrument with price-time priority.
+//
+// Each side is an array of price levels indexed by tick (offset from a
+// base that moves as orders arrive outside the window), and each level is
+// a FIFO list of orders from the pool. The best bid and ask are tracked as
+// indexes, so matching walks contiguous memory. A side that empties drops
+// back to a small window, so one far-off order does not pin a wide ladder.
+// Not thread-safe: a book is owned by a single matcher thread.
+class OrderBook {
+public:
+    enum Side : uint8_t { BUY = 0, SELL = 1 };
+
+    // Widest span of ticks one side may cover (bounds memory per book)
+    static const int64_t MAX_SPAN = int64_t(1) << 22;
+
+    struct Result {
+        bool accepted = false;  // false if nothing filled and the price is outside the book's range
+        uint64_t id = 0;        // of the resting remainder (0 if nothing rests)
+        int32_t filled = 0;
+        int32_t resting = 0;
+    };
+
+    // Match an incoming limit order and rest whatever is left. on_fill is
+    // called for each match, in the order they happen, and must not call
+    // back into the book. A remainder whose price the resting side cannot
+    // reach within MAX_SPAN is dropped rather than rested.
+    template <typename OnFill>
+    Result add(uint32_t owner, Side side, int64_t price, int32_t quantity, OnFill&& on_fill);
+
+    // Remove a resting order; returns its open quantity (0 if not found)
+    int32_t cancel(uint64_t id);
+
+    // Reduce an order's open quantity keeping its place in the queue
+    bool reduce(uint64_t id, int32_t quantity);
+
+    // The resting order with this id, or nullptr
+    const Order* find(uint64_t id) const;
+
+    bool hasBid() const { return bids.count > 0; }
+    bool hasAsk() const { return asks.count > 0; }
+    int64_t bestBid() const { return bids.base + bids.best; }
+    int64_t bestAsk() const { return asks.base + asks.best; }
+    // Open quantity at one price on one side
+    int64_t depthAt(Side side, int64_t price) const;
+    size_t openOrders() const { return open_orders; }
+
+private:
+    struct Level {
+        uint32_t head = OrderPool::NONE;
+        uint32_t tail = OrderPool::NONE;
+        int64_t quantity = 0;
+    };
+
+    struct Ladder {
+        int64_t base = 0;          // price of levels[0]
+        std::vector<Level> levels;
+        int64_t best = 0;          // index of the best non-empty level (valid if count > 0)
+        size_t count = 0;          // non-empty levels
+        bool descending = false;   // bids: best is the highest price
+    };
+
+    bool ensureLevel(Ladder& ladder, int64_t price);
+    void shrinkIfEmpty(Ladder& ladder);
+    void append(Ladder& ladder, uint32_t slot);
+    void unlink(Ladder& ladder, uint32_t slot);
+    void advanceBest(Ladder& ladder);
+    uint32_t slotOf(uint64_t id) const;
+
+    Ladder bids{0, {}, 0, 0, true};
+    Ladder asks{0, {}, 0, 0, false};
+    OrderPool pool;
+    std::vector<uint32_t> generations;  // per slot, bumped on reuse
+    size_t open_orders = 0;
+};
+
+template <typename OnFill>
+OrderBook::Result OrderBook::add(uint32_t owner, Side side, int64_t price, int32_t quantity, OnFill&& on_fill) {
+    Result result;
+    if (quantity <= 0 || price <= 0) return result;
+    Ladder& own = side == BUY ? bids : asks;
+    Ladder& other = side == BUY ? asks : bids;
+
+    // Match against the other side while it crosses
+    while (quantity > 0 && other.count > 0) {
+        int64_t best_price = other.base + other.best;
+        if (side == BUY ? best_price > price : best_price < price) break;
+
+        Level& level = other.levels[other.best];
+        while (quantity > 0 && level.head != OrderPool::NONE) {
+            uint32_t slot = level.head;
+            Order& maker = pool[slot];
+            int32_t traded = std::min(quantity, maker.quantity);
+            maker.quantity -= traded;
+            level.quantity -= traded;
+            quantity -= traded;
+            result.filled += traded;
+            bool done = maker.quantity == 0;
+            on_fill(Fill{maker.id, maker.owner, owner, static_cast<uint8_t>(side), best_price, traded, done});
+            if (done) {
+                unlink(other, slot);  // moves other.best on once the level empties
+                pool.release(slot);
+                --open_orders;
+            }
+        }
+    }
+    shrinkIfEmpty(other);
+    result.accepted = result.filled > 0;
+
+    // Only a resting remainder needs a level on its own side
+    if (quantity > 0 && ensureLevel(own, price)) {
+        result.accepted = true;
+        uint32_t slot = pool.allocate();
+        if (slot >= generations.size()) generations.resize(slot + 1, 0);
+        Order& order = pool[slot];
+        order.id = (static_cast<uint64_t>(++generations[slot]) << 32) | slot;
+        order.price = price;
+        order.quantity = quantity;
+        order.owner = owner;
+        order.side = side;
+        order.live = true;
+        append(own, slot);
+        ++open_orders;
+        result.id = order.id;
+        result.resting = quantity;
+    }
+    return result;
+}
+
+#endif
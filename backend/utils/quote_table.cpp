@@ -0,0 +1,206 @@
+#include "quote_table.h"
+#include "csv.h"
+#include "logger.h"
+#include <chrono>
+#include <charconv>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+const std::string MARKET_FILE = "db/market.csv";
+
+// How often the watcher checks for shutdown (and, without inotify, mtime)
+const int WATCH_INTERVAL_MS = 500;
+
+namespace {
+
+std::string_view stripCarriageReturn(std::string_view s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+    return s;
+}
+
+// Shortest text that reads back as the same price
+std::string formatPrice(double price) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), price);
+    return std::string(text, result.ptr);
+}
+
+std::unique_ptr<MarketSnapshot> loadSnapshot(const std::string& filename) {
+    auto snapshot = std::make_unique<MarketSnapshot>();
+    auto index = std::make_shared<TickerIndex>();
+    visitCSV(filename, [&snapshot, &index](const CsvRow& row) {
+        Quote quote;
+        if (!row.get(2, quote.price)) return;  // skip rows without a numeric price
+        quote.ticker = row[0];
+        quote.name = row[1];
+        quote.price_text = stripCarriageReturn(row[2]);
+        (*index)[quote.ticker] = snapshot->quotes.size();
+        snapshot->quotes.push_back(std::move(quote));
+    }, &snapshot->file_version);
+    snapshot->index = std::move(index);
+    return snapshot;
+}
+
+std::string baseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+}  // namespace
+
+void QuoteList::push_back(Quote quote) {
+    if (count % CHUNK == 0) {
+        chunks.push_back(std::make_shared<std::vector<Quote>>());
+        chunks.back()->reserve(CHUNK);
+        owned.push_back(true);
+    }
+    ownChunk(count / CHUNK).push_back(std::move(quote));
+    ++count;
+}
+
+Quote& QuoteList::mutableAt(size_t i) {
+    return ownChunk(i / CHUNK)[i % CHUNK];
+}
+
+std::vector<Quote>& QuoteList::ownChunk(size_t chunk) {
+    if (!owned[chunk]) {
+        auto copy = std::make_shared<std::vector<Quote>>(*chunks[chunk]);
+        copy->reserve(CHUNK);
+        chunks[chunk] = std::move(copy);
+        owned[chunk] = true;
+    }
+    return *chunks[chunk];
+}
+
+const std::string& MarketSnapshot::marketData() const {
+    std::call_once(rendered, [this] {
+        market_data = "DATA|";
+        for (const auto& quote : quotes) {
+            market_data += quote.ticker + "," + quote.name + "," + quote.price_text + ";";
+        }
+    });
+    return market_data;
+}
+
+QuoteTable::QuoteTable(const std::string& filename)
+    : filename(filename), current(loadSnapshot(filename)) {}
+
+QuoteTable::~QuoteTable() {
+    stopping = true;
+    if (watcher.joinable()) watcher.join();
+}
+
+bool QuoteTable::reload() {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    auto snapshot = loadSnapshot(filename);
+    if (snapshot->quotes.empty()) {
+        return false;  // missing or empty; keep serving the last good prices
+    }
+    if (snapshot->file_version == current.read()->file_version) {
+        return false;  // nothing new (e.g. a second event for one replacement)
+    }
+    snapshot->version = next_version++;
+    if (!listeners.empty()) {
+        auto previous = current.read();
+        for (const auto& listener : listeners) listener(*previous, *snapshot);
+    }
+    current.publish(std::move(snapshot));
+    return true;
+}
+
+size_t QuoteTable::applyPrices(const std::vector<PriceChange>& changes) {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    auto next = std::make_unique<MarketSnapshot>();
+    {
+        auto previous = current.read();
+        next->file_version = previous->file_version;
+        next->quotes = previous->quotes;
+        next->index = previous->index;
+        next->incremental = true;
+
+        std::shared_ptr<TickerIndex> grown;  // copied only if a ticker is new
+        for (const auto& change : changes) {
+            const TickerIndex& index = grown ? *grown : *next->index;
+            auto it = index.find(change.ticker);
+            if (it == index.end()) {
+                if (!grown) grown = std::make_shared<TickerIndex>(*next->index);
+                (*grown)[change.ticker] = next->quotes.size();
+                next->updated.push_back(next->quotes.size());
+                next->quotes.push_back({change.ticker, change.ticker, formatPrice(change.price), change.price});
+                continue;
+            }
+            if (next->quotes[it->second].price == change.price) continue;
+            Quote& quote = next->quotes.mutableAt(it->second);
+            quote.price = change.price;
+            quote.price_text = formatPrice(change.price);
+            next->updated.push_back(it->second);
+        }
+        if (next->updated.empty()) return 0;
+        if (grown) next->index = std::move(grown);
+        next->version = next_version++;
+        for (const auto& listener : listeners) listener(*previous, *next);
+    }
+    // The read guard is gone: publish waits for readers of the old generation
+    size_t changed = next->updated.size();
+    current.publish(std::move(next));
+    return changed;
+}
+
+void QuoteTable::addListener(Listener listener) {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    listeners.push_back(std::move(listener));
+}
+
+void QuoteTable::watch() {
+    if (watching.exchange(true)) return;
+    watcher = std::thread([this] { watchLoop(); });
+}
+
+void QuoteTable::watchLoop() {
+#ifdef __linux__
+    // Watch the directory so both in-place rewrites and rename-over are seen
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int wd = fd < 0 ? -1 : inotify_add_watch(fd, parentDirectory(filename).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd >= 0) {
+        const std::string name = baseName(filename);
+        alignas(inotify_event) char buffer[4096];
+        while (!stopping) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, WATCH_INTERVAL_MS) <= 0) continue;
+
+            bool changed = false;
+            ssize_t n;
+            while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + n;) {
+                    auto* event = reinterpret_cast<inotify_event*>(p);
+                    if (event->len > 0 && name == event->name) changed = true;
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (changed) reload();
+        }
+        close(fd);
+        return;
+    }
+    LOG_WARN("inotify unavailable, polling " << filename);
+    if (fd >= 0) close(fd);
+#endif
+
+    SnapshotVersion last = snapshotVersion(filename);
+    while (!stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+        SnapshotVersion now = snapshotVersion(filename);
+        if (now.exists() && now != last) {
+            last = now;
+            reload();
+        }
+    }
+}
+
+QuoteTable& quoteTable() {
+    static QuoteTable table(MARKET_FILE);
+    return table;
+}
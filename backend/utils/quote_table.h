@@ -0,0 +1,171 @@
+#ifndef QUOTE_TABLE_H
+#define QUOTE_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include "rcu.h"
+#include "snapshot.h"
+
+struct Quote {
+    std::string ticker;
+    std::string name;
+    std::string price_text;  // as written in market.csv
+    double price = 0.0;
+};
+
+// Quotes of one generation in file order. They are stored in chunks that
+// a generation derived from this one shares until it changes a quote in
+// them (copy-on-write), so a price update copies one chunk, not the table.
+class QuoteList {
+public:
+    static const size_t CHUNK = 64;
+
+    class const_iterator {
+    public:
+        const_iterator(const QuoteList* list, size_t i) : list(list), i(i) {}
+        const Quote& operator*() const { return (*list)[i]; }
+        const Quote* operator->() const { return &(*list)[i]; }
+        const_iterator& operator++() { ++i; return *this; }
+        bool operator!=(const const_iterator& other) const { return i != other.i; }
+        bool operator==(const const_iterator& other) const { return i == other.i; }
+
+    private:
+        const QuoteList* list;
+        size_t i;
+    };
+
+    QuoteList() = default;
+    // A copy shares every chunk; it copies one only when writing to it
+    QuoteList(const QuoteList& other) : chunks(other.chunks), owned(other.chunks.size(), false), count(other.count) {}
+    QuoteList& operator=(const QuoteList& other) {
+        chunks = other.chunks;
+        owned.assign(chunks.size(), false);
+        count = other.count;
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Quote& operator[](size_t i) const { return (*chunks[i / CHUNK])[i % CHUNK]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    void push_back(Quote quote);
+    // Quote i for writing (only before the generation is published)
+    Quote& mutableAt(size_t i);
+
+private:
+    std::vector<Quote>& ownChunk(size_t chunk);
+
+    std::vector<std::shared_ptr<std::vector<Quote>>> chunks;
+    std::vector<bool> owned;  // chunk was created or copied by this list
+    size_t count = 0;
+};
+
+using TickerIndex = std::unordered_map<std::string, size_t>;
+
+// One immutable generation of the market
+struct MarketSnapshot {
+    uint64_t version = 0;
+    SnapshotVersion file_version;        // generation of market.csv it came from
+    QuoteList quotes;                    // file order, then tickers added by the feed
+    std::shared_ptr<const TickerIndex> index;  // ticker -> quotes[i], shared while the tickers don't change
+
+    // Set when this generation is the previous one with the prices at
+    // these quotes changed (QuoteTable::applyPrices); a reload of the file
+    // may change anything
+    bool incremental = false;
+    std::vector<size_t> updated;
+
+    const Quote* find(const std::string& ticker) const {
+        if (!index) return nullptr;
+        auto it = index->find(ticker);
+        return it == index->end() ? nullptr : &quotes[it->second];
+    }
+
+    // GET_MARKET response body, rendered on first use
+    const std::string& marketData() const;
+
+private:
+    mutable std::once_flag rendered;
+    mutable std::string market_data;
+};
+
+// Calls visit(quote) for each quote of next that may differ from previous,
+// its predecessor (as passed to a QuoteTable listener)
+template <typename Visit>
+void forEachChangedQuote(const MarketSnapshot& next, Visit&& visit) {
+    if (next.incremental) {
+        for (size_t i : next.updated) visit(next.quotes[i]);
+    } else {
+        for (const auto& quote : next.quotes) visit(quote);
+    }
+}
+
+// A new price for one ticker, from a market data feed
+struct PriceChange {
+    std::string ticker;
+    double price = 0.0;
+};
+
+// Shared in-memory quote table for market.csv.
+//
+// Readers get the current snapshot through an RcuCell and never lock or
+// touch the disk. A watcher thread reloads the file when it is replaced
+// (inotify on Linux, polling its SnapshotVersion elsewhere) and publishes
+// the new generation atomically. Writers are expected to replace the file
+// whole (market_updater.py renames a temp file over it), so every load
+// sees one complete generation.
+//
+// A market feed (MarketFeed) publishes price changes in between: each
+// batch becomes a new generation copied from the current one. Rewriting
+// market.csv still replaces the whole table.
+class QuoteTable {
+public:
+    explicit QuoteTable(const std::string& filename);
+    ~QuoteTable();
+
+    RcuCell<MarketSnapshot>::ReadGuard snapshot() const { return current.read(); }
+
+    // Re-read the file and publish it; keeps the old snapshot if the file
+    // is missing, has no rows or is the generation already published
+    bool reload();
+
+    // Publish a generation with these prices changed (tickers not yet in
+    // the table are added, named after their ticker); returns how many
+    // prices actually changed
+    size_t applyPrices(const std::vector<PriceChange>& changes);
+
+    // Start the watcher thread (idempotent)
+    void watch();
+
+    // Called on the publishing thread with the outgoing and incoming
+    // generations, just before the new one is published
+    using Listener = std::function<void(const MarketSnapshot& previous, const MarketSnapshot& next)>;
+    void addListener(Listener listener);
+
+private:
+    void watchLoop();
+
+    const std::string filename;
+    RcuCell<MarketSnapshot> current;
+    std::mutex reload_mutex;
+    std::vector<Listener> listeners;  // guarded by reload_mutex
+    uint64_t next_version = 1;
+    std::atomic<bool> watching{false};
+    std::atomic<bool> stopping{false};
+    std::thread watcher;
+};
+
+// Process-wide table backed by db/market.csv
+QuoteTable& quoteTable();
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef RCU_H
+#define RCU_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+// Read-copy-update cell holding an immutable T.
+//
+// Readers never lock: read() registers in the current epoch's reader count,
+// loads the pointer and unregisters when the guard goes away. A writer
+// publishes a complete new object with one atomic exchange, then waits for
+// a grace period (two epoch flips, each waiting for the previous epoch's
+// readers to drain) before deleting the old one. Writes are expected to be
+// rare compared to reads.
+template <typename T>
+class RcuCell {
+public:
+    class ReadGuard {
+    public:
+        ReadGuard(const RcuCell* cell, int slot, const T* value)
+            : cell(cell), slot(slot), value(value) {}
+        ReadGuard(ReadGuard&& other) noexcept
+            : cell(other.cell), slot(other.slot), value(other.value) {
+            other.cell = nullptr;
+        }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+        ~ReadGuard() {
+            if (cell) cell->readers[slot].fetch_sub(1, std::memory_order_release);
+        }
+
+        const T* get() const { return value; }
+        const T* operator->() const { return value; }
+        const T& operator*() const { return *value; }
+
+    private:
+        const RcuCell* cell;
+        int slot;
+        const T* value;
+    };
+
+    explicit RcuCell(std::unique_ptr<const T> initial) : current(initial.release()) {}
+
+    ~RcuCell() {
+        delete current.load();
+    }
+
+    RcuCell(const RcuCell&) = delete;
+    RcuCell& operator=(const RcuCell&) = delete;
+
+    ReadGuard read() const {
+        int slot = static_cast<int>(epoch.load() & 1);
+        readers[slot].fetch_add(1);
+        return ReadGuard(this, slot, current.load());
+    }
+
+    // Replace the value; returns once no reader can still see the old one
+    void publish(std::unique_ptr<const T> next) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        const T* old = current.exchange(next.release());
+        synchronize();
+        delete old;
+    }
+
+private:
+    void synchronize() {
+        for (int phase = 0; phase < 2; ++phase) {
+            uint64_t previous = epoch.fetch_add(1);
+            int slot = static_cast<int>(previous & 1);
+            while (readers[slot].load(std::memory_order_acquire) != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::atomic<const T*> current;
+    mutable std::atomic<uint64_t> epoch{0};
+    mutable std::atomic<int> readers[2] = {{0}, {0}};
+    std::mutex writer_mutex;
+};
+
+#endif // RCU_H
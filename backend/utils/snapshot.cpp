@@ -0,0 +1,114 @@
+#include "snapshot.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+SnapshotVersion versionOf(const struct stat& st) {
+    SnapshotVersion version;
+    version.device = static_cast<uint64_t>(st.st_dev);
+    version.inode = static_cast<uint64_t>(st.st_ino);
+    version.size = static_cast<uint64_t>(st.st_size);
+#ifdef __APPLE__
+    version.modified_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    version.modified_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return version;
+}
+
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+}  // namespace
+
+bool replaceFile(const std::string& path, std::string_view contents) {
+    // Unique per writer so concurrent replacements never share a temp file
+    static std::atomic<uint64_t> sequence{0};
+    std::string tmp = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(sequence++);
+
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, contents) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        int saved = errno;
+        ::unlink(tmp.c_str());
+        errno = saved;
+        return false;
+    }
+    return syncPath(parentDirectory(path));
+}
+
+size_t removeStaleTemporaries(const std::string& directory) {
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) return 0;
+    size_t removed = 0;
+    while (dirent* entry = ::readdir(dir)) {
+        // <file>.tmp.<pid>.<n>, or <file>.tmp from older builds
+        std::string_view name(entry->d_name);
+        bool temporary = name.find(".tmp.") != std::string_view::npos ||
+                         (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0);
+        if (temporary && ::unlink((directory + "/" + entry->d_name).c_str()) == 0) ++removed;
+    }
+    ::closedir(dir);
+    return removed;
+}
+
+bool syncPath(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+SnapshotVersion snapshotVersion(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? versionOf(st) : SnapshotVersion{};
+}
+
+SnapshotVersion snapshotVersion(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? versionOf(st) : SnapshotVersion{};
+}
+
+uint32_t crc32(const char* data, size_t length) {
+    static uint32_t table[256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)initialized;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,53 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Crash-safe replacement of the files under db/.
+//
+// replaceFile writes the new contents to a temporary file in the same
+// directory, fsyncs it, renames it over the target and fsyncs the
+// directory. A reader therefore opens either the complete old generation
+// or the complete new one, and a reader that already has the old one open
+// (or mapped) keeps a stable copy until it closes it; nobody needs a lock.
+// After a crash the target holds one of the two generations, never a mix.
+bool replaceFile(const std::string& path, std::string_view contents);
+
+// Delete the temporary files a crashed replaceFile left in directory;
+// only safe before anything in it is being replaced. Returns how many.
+size_t removeStaleTemporaries(const std::string& directory);
+
+// fsync a file or directory by path
+bool syncPath(const std::string& path);
+
+std::string parentDirectory(const std::string& path);
+
+// Identifies one generation of a file. Every replaceFile produces a new
+// inode, so two equal versions are the same contents even when the
+// rewrites land within one mtime tick.
+struct SnapshotVersion {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t modified_ns = 0;
+
+    bool exists() const { return inode != 0; }
+    bool operator==(const SnapshotVersion& other) const {
+        return device == other.device && inode == other.inode && size == other.size &&
+               modified_ns == other.modified_ns;
+    }
+    bool operator!=(const SnapshotVersion& other) const { return !(*this == other); }
+};
+
+// CRC-32 (IEEE) of a record, for detecting torn or corrupt log entries
+uint32_t crc32(const char* data, size_t length);
+
+// Version of the file currently at path (exists() is false if missing)
+SnapshotVersion snapshotVersion(const std::string& path);
+
+// Version of an open file, e.g. the one a reader is about to map
+SnapshotVersion snapshotVersion(int fd);
+
+#endif
@@ -0,0 +1,334 @@
+#include "tick_store.h"
+#include "snapshot.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Flush a block early once its payload reaches this size
+const size_t MAX_BLOCK_BYTES = 1 << 20;
+const size_t BLOCK_HEADER = 8;
+
+namespace {
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool getVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putU32(char* out, uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+uint32_t getU32(const char* in) {
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+size_t fileSize(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+// Call use() with the first length bytes of fd mapped read-only
+bool withMapping(int fd, size_t length, const std::function<void(const char* data)>& use) {
+    void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) return false;
+    use(static_cast<const char*>(mapped));
+    ::munmap(mapped, length);
+    return true;
+}
+
+}  // namespace
+
+TickStore::TickStore(const std::string& directory, int64_t retention_ms)
+    : directory(directory), retention_ms(retention_ms) {}
+
+TickStore::~TickStore() {
+    flush();
+    if (fd >= 0) ::close(fd);
+}
+
+std::string TickStore::segmentPath(int64_t day) const {
+    return directory + "/ticks-" + std::to_string(day) + ".log";
+}
+
+std::vector<int64_t> TickStore::listSegments() const {
+    std::vector<int64_t> days;
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) return days;
+    while (dirent* entry = ::readdir(dir)) {
+        const char* name = entry->d_name;
+        if (std::strncmp(name, "ticks-", 6) != 0) continue;
+        char* end;
+        long long day = std::strtoll(name + 6, &end, 10);
+        if (end == name + 6 || std::strcmp(end, ".log") != 0 || day < 0) continue;
+        days.push_back(day);
+    }
+    ::closedir(dir);
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+bool TickStore::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ::mkdir(directory.c_str(), 0755);
+    if (!tickers.open(directory + "/tickers.dict")) return false;
+    opened = true;
+
+    // A single ticks.log from before segments becomes the segment of its last tick
+    std::string legacy = directory + "/ticks.log";
+    int legacy_fd = ::open(legacy.c_str(), O_RDONLY | O_CLOEXEC);
+    if (legacy_fd >= 0) {
+        size_t length = fileSize(legacy_fd);
+        int64_t last = -1;
+        if (length > 0) {
+            withMapping(legacy_fd, length, [&](const char* data) {
+                decode(data, length, [&](uint32_t, int64_t time_ms, int64_t) { last = time_ms; });
+            });
+        }
+        ::close(legacy_fd);
+        if (length == 0) {
+            ::unlink(legacy.c_str());
+        } else if (last < 0 || ::access(segmentPath(last / SEGMENT_MS).c_str(), F_OK) == 0 ||
+                   ::rename(legacy.c_str(), segmentPath(last / SEGMENT_MS).c_str()) != 0) {
+            LOG_WARN("Cannot move " << legacy << " into a segment; it is no longer read");
+        }
+    }
+
+    std::vector<int64_t> days = listSegments();
+    if (days.empty()) return true;  // the first append starts a segment
+    for (size_t i = 0; i + 1 < days.size(); ++i) {
+        int sealed_fd = ::open(segmentPath(days[i]).c_str(), O_RDONLY | O_CLOEXEC);
+        if (sealed_fd < 0) continue;
+        sealed_bytes += fileSize(sealed_fd);
+        ::close(sealed_fd);
+    }
+    return openSegment(days.back());
+}
+
+bool TickStore::openSegment(int64_t day) {
+    if (fd >= 0) {
+        ::close(fd);
+        sealed_bytes += size;
+    }
+    fd = -1;
+    size = 0;
+    segment_day = day;
+    std::string path = segmentPath(day);
+    int segment_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (segment_fd < 0) {
+        LOG_ERROR("Cannot open " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    // Only the newest segment can have a torn tail; a new one is empty
+    size_t file_size = fileSize(segment_fd);
+    size_t valid = 0;
+    if (file_size > 0 && !withMapping(segment_fd, file_size, [&](const char* data) {
+            valid = decode(data, file_size, [this](uint32_t, int64_t time_ms, int64_t) {
+                last_time = std::max(last_time, time_ms);
+            });
+        })) {
+        ::close(segment_fd);
+        return false;
+    }
+    if (valid < file_size) {
+        LOG_WARN("Dropping " << file_size - valid << " damaged bytes at the end of " << path);
+        if (::ftruncate(segment_fd, static_cast<off_t>(valid)) != 0) {
+            ::close(segment_fd);
+            return false;
+        }
+    }
+    fd = segment_fd;
+    size = valid;
+    if (retention_ms > 0) removeBeforeLocked(day * SEGMENT_MS - retention_ms);
+    return true;
+}
+
+void TickStore::append(std::string_view ticker, int64_t time_ms, double price) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!opened) return;
+    time_ms = std::max(time_ms, last_time);
+    int64_t day = time_ms / SEGMENT_MS;
+    if (day != segment_day) {
+        flushLocked();
+        openSegment(day);
+    }
+    if (fd < 0) return;
+    uint32_t id = tickers.intern(ticker);
+    if (id == UINT32_MAX) return;
+    if (id >= block_price.size()) {
+        block_price.resize(id + 1, 0);
+        block_stamp.resize(id + 1, 0);
+    }
+
+    if (block.empty()) {
+        putVarint(block, static_cast<uint64_t>(time_ms));
+        last_time = time_ms;
+    }
+    int64_t scaled = std::llround(price * PRICE_SCALE);
+    int64_t previous = block_stamp[id] == block_number ? block_price[id] : 0;
+    putVarint(block, id);
+    putVarint(block, static_cast<uint64_t>(time_ms - last_time));
+    putVarint(block, zigzag(scaled - previous));
+    block_price[id] = scaled;
+    block_stamp[id] = block_number;
+    last_time = time_ms;
+    if (block.size() >= MAX_BLOCK_BYTES) flushLocked();
+}
+
+bool TickStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flushLocked();
+}
+
+bool TickStore::flushLocked() {
+    if (block.empty() || fd < 0) return true;
+    std::string framed(BLOCK_HEADER, '\0');
+    putU32(&framed[0], static_cast<uint32_t>(block.size()));
+    putU32(&framed[4], crc32(block.data(), block.size()));
+    framed += block;
+    block.clear();
+    ++block_number;
+
+    ssize_t written = ::write(fd, framed.data(), framed.size());
+    if (written != static_cast<ssize_t>(framed.size())) {
+        LOG_ERROR("Cannot append to " << segmentPath(segment_day) << ": " << std::strerror(errno));
+        // Cut off a partial block so the next one starts on a boundary
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+    size += framed.size();
+    return true;
+}
+
+void TickStore::removeBefore(int64_t time_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    removeBeforeLocked(time_ms);
+}
+
+void TickStore::removeBeforeLocked(int64_t time_ms) {
+    for (int64_t day : listSegments()) {
+        if (day >= time_ms / SEGMENT_MS) break;
+        std::string path = segmentPath(day);
+        if (day == segment_day) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+            segment_day = -1;
+            size = 0;
+            block.clear();
+            ++block_number;
+        } else {
+            int sealed_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (sealed_fd >= 0) {
+                sealed_bytes -= std::min(sealed_bytes, fileSize(sealed_fd));
+                ::close(sealed_fd);
+            }
+        }
+        if (::unlink(path.c_str()) == 0) {
+            LOG_INFO("Removed expired tick segment " << path);
+        } else {
+            LOG_WARN("Cannot remove " << path << ": " << std::strerror(errno));
+        }
+    }
+}
+
+size_t TickStore::decode(const char* data, size_t size,
+                         const std::function<void(uint32_t ticker, int64_t time_ms, int64_t price)>& visit) {
+    size_t offset = 0;
+    std::vector<int64_t> prices;
+    std::vector<size_t> stamps;  // block offset + 1 that prices[id] belongs to
+    while (offset + BLOCK_HEADER <= size) {
+        uint32_t length = getU32(data + offset);
+        uint32_t crc = getU32(data + offset + 4);
+        if (length == 0 || length > size - offset - BLOCK_HEADER) break;
+        const char* p = data + offset + BLOCK_HEADER;
+        const char* end = p + length;
+        if (crc32(p, length) != crc) break;
+
+        uint64_t time, id, delta, change;
+        if (!getVarint(p, end, time)) break;
+        while (p < end) {
+            if (!getVarint(p, end, id) || !getVarint(p, end, delta) || !getVarint(p, end, change)) {
+                return offset;  // checksummed but malformed: stop before it
+            }
+            if (id >= prices.size()) {
+                prices.resize(id + 1, 0);
+                stamps.resize(id + 1, 0);
+            }
+            time += delta;
+            int64_t previous = stamps[id] == offset + 1 ? prices[id] : 0;
+            prices[id] = previous + unzigzag(change);
+            stamps[id] = offset + 1;
+            visit(static_cast<uint32_t>(id), static_cast<int64_t>(time), prices[id]);
+        }
+        offset += BLOCK_HEADER + length;
+    }
+    return offset;
+}
+
+void TickStore::forEach(
+    int64_t from_ms,
+    const std::function<void(const std::string& ticker, int64_t time_ms, double price)>& visit) const {
+    std::vector<std::pair<std::string, size_t>> segments;  // path and bytes to read
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int64_t day : listSegments()) {
+            if (day < from_ms / SEGMENT_MS) continue;
+            segments.emplace_back(segmentPath(day), day == segment_day ? size : SIZE_MAX);
+        }
+    }
+
+    std::vector<std::string> names;
+    auto named = [&](uint32_t ticker, int64_t time_ms, int64_t price) {
+        while (names.size() <= ticker) names.push_back(tickers.name(static_cast<uint32_t>(names.size())));
+        visit(names[ticker], time_ms, static_cast<double>(price) / PRICE_SCALE);
+    };
+    for (const auto& [path, limit] : segments) {
+        int read_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (read_fd < 0) continue;  // removed since it was listed
+        size_t length = std::min(limit, fileSize(read_fd));
+        if (length > 0) {
+            withMapping(read_fd, length, [&](const char* data) { decode(data, length, named); });
+        }
+        ::close(read_fd);
+    }
+}
+
+size_t TickStore::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sealed_bytes + size;
+}
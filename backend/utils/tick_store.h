@@ -0,0 +1,96 @@
+#ifndef TICK_STORE_H
+#define TICK_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include "dictionary.h"
+
+// Append-only, delta-encoded log of price ticks (db/ticks/).
+//
+// The log is split into one segment per UTC day, ticks-<days since the
+// epoch>.log, and a block never spans two segments. Each segment is a
+// sequence of blocks, each written with one write():
+//   u32 payload length | u32 CRC-32 of the payload | payload
+// A payload is the block's base time (varint, ms since the epoch) and then
+// one record per tick:
+//   varint ticker id | varint ms since the previous tick | zigzag varint price change
+// Prices are integer 1/10000ths; the change is against the same ticker's
+// previous price in the block (against zero the first time it appears),
+// so a tick of a quietly moving price takes four or five bytes. Each block
+// decodes on its own, and a torn or corrupt block at the end is found by
+// its length or checksum and cut off when the store opens. Ticker names
+// are in tickers.dict, shared by all segments.
+//
+// Ticks are buffered and written a block at a time by flush(); the log is
+// market data, not a record of trades, and is not fsynced. Reads map only
+// the segments that overlap the requested window. With a retention set,
+// segments that end more than that long before the current one are
+// deleted whenever a new segment starts, so the log does not grow without
+// bound. A ticks.log from before segments is renamed to the segment of
+// its last tick.
+class TickStore {
+public:
+    static const int64_t PRICE_SCALE = 10000;
+    static const int64_t SEGMENT_MS = 24 * 60 * 60 * 1000;
+
+    // retention_ms 0 keeps every segment
+    explicit TickStore(const std::string& directory, int64_t retention_ms = 0);
+    ~TickStore();
+    TickStore(const TickStore&) = delete;
+    TickStore& operator=(const TickStore&) = delete;
+
+    // Open the log, dropping any damaged tail of the newest segment
+    bool open();
+
+    // Buffer one tick; times are clamped so they never decrease
+    void append(std::string_view ticker, int64_t time_ms, double price);
+
+    // Write the buffered ticks as one block
+    bool flush();
+
+    // Decode the flushed ticks of every segment that ends after from_ms,
+    // oldest first; the first segment may still hold earlier ticks
+    void forEach(int64_t from_ms,
+                 const std::function<void(const std::string& ticker, int64_t time_ms, double price)>& visit) const;
+
+    // Delete the segments that end at or before time_ms
+    void removeBefore(int64_t time_ms);
+
+    // Size of all segments
+    size_t bytes() const;
+
+private:
+    bool flushLocked();
+    bool openSegment(int64_t day);
+    void removeBeforeLocked(int64_t time_ms);
+    std::string segmentPath(int64_t day) const;
+
+    // Days of the segments on disk, oldest first
+    std::vector<int64_t> listSegments() const;
+
+    // Decode the valid prefix of [data, data + size), returning its length
+    static size_t decode(const char* data, size_t size,
+                         const std::function<void(uint32_t ticker, int64_t time_ms, int64_t price)>& visit);
+
+    const std::string directory;
+    const int64_t retention_ms;
+    NameDictionary tickers;
+
+    mutable std::mutex mutex;  // guards everything below
+    bool opened = false;
+    int fd = -1;               // open segment
+    int64_t segment_day = -1;  // day of the open segment, -1 for none
+    size_t size = 0;           // bytes of complete blocks in the open segment
+    size_t sealed_bytes = 0;   // bytes in the other segments
+    std::string block;         // payload being built
+    int64_t last_time = 0;     // of the last tick appended
+    std::vector<int64_t> block_price;     // per ticker id: last price in the current block
+    std::vector<uint64_t> block_stamp;    // per ticker id: block block_price belongs to
+    uint64_t block_number = 1;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "trade_store.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Rows added to a column file each time it fills up
+const size_t GROW_ROWS = 1 << 20;
+
+TradeStore::TradeStore(const std::string& directory) : directory(directory) {}
+
+TradeStore::~TradeStore() {
+    for (auto& column : columns) {
+        if (column.data) ::munmap(column.data, MAX_ROWS * column.width);
+        if (column.fd >= 0) ::close(column.fd);
+    }
+    if (persisted_rows) ::munmap(persisted_rows, sizeof(uint64_t));
+    if (rows_fd >= 0) ::close(rows_fd);
+}
+
+bool TradeStore::open() {
+    ::mkdir(directory.c_str(), 0755);
+    if (!openColumn(USER, "user.u32", sizeof(uint32_t)) || !openColumn(TICKER, "ticker.u32", sizeof(uint32_t)) ||
+        !openColumn(SIDE, "side.u8", sizeof(uint8_t)) || !openColumn(QUANTITY, "quantity.i32", sizeof(int32_t)) ||
+        !openColumn(PRICE, "price.f64", sizeof(double)) || !openColumn(TIME, "time.i64", sizeof(int64_t))) {
+        return false;
+    }
+    if (!users_dict.open(directory + "/users.dict") || !tickers_dict.open(directory + "/tickers.dict")) {
+        return false;
+    }
+
+    std::string rows_path = directory + "/rows";
+    rows_fd = ::open(rows_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (rows_fd < 0 || ::ftruncate(rows_fd, sizeof(uint64_t)) != 0) return false;
+    void* mapped = ::mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, rows_fd, 0);
+    if (mapped == MAP_FAILED) return false;
+    persisted_rows = static_cast<uint64_t*>(mapped);
+
+    // Never trust a count beyond what every column actually holds
+    size_t rows = static_cast<size_t>(*persisted_rows);
+    for (const auto& column : columns) rows = std::min(rows, column.capacity);
+    count.store(rows, std::memory_order_release);
+    last_time = rows > 0 ? times()[rows - 1] : 0;
+    return true;
+}
+
+bool TradeStore::openColumn(Column column, const std::string& name, size_t width) {
+    MappedColumn& mapped = columns[column];
+    std::string path = directory + "/" + name;
+    mapped.fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (mapped.fd < 0) return false;
+    struct stat st;
+    if (::fstat(mapped.fd, &st) != 0) return false;
+    mapped.width = width;
+    mapped.capacity = static_cast<size_t>(st.st_size) / width;
+
+    // Reserve the address range for the largest possible file up front;
+    // only the part backed by the file is ever touched
+    void* data = ::mmap(nullptr, MAX_ROWS * width, PROT_READ | PROT_WRITE, MAP_SHARED, mapped.fd, 0);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Cannot map " << path << ": " << errno);
+        return false;
+    }
+    mapped.data = data;
+    return true;
+}
+
+bool TradeStore::reserve(size_t rows) {
+    for (auto& column : columns) {
+        if (rows <= column.capacity) continue;
+        size_t capacity = std::min(MAX_ROWS, std::max(rows, column.capacity + GROW_ROWS));
+        if (rows > capacity || ::ftruncate(column.fd, static_cast<off_t>(capacity * column.width)) != 0) {
+            LOG_ERROR("Cannot grow trade store in " << directory << ": " << errno);
+            return false;
+        }
+        column.capacity = capacity;
+    }
+    return true;
+}
+
+void TradeStore::storeCount(size_t rows) {
+    *persisted_rows = rows;
+    count.store(rows, std::memory_order_release);
+}
+
+bool TradeStore::append(std::string_view user, Side side, std::string_view ticker, int32_t quantity, double price,
+                        int64_t time_ms) {
+    size_t row = count.load(std::memory_order_relaxed);
+    if (!reserve(row + 1)) return false;
+    uint32_t user_id = users_dict.intern(user);
+    uint32_t ticker_id = tickers_dict.intern(ticker);
+    if (user_id == UINT32_MAX || ticker_id == UINT32_MAX) return false;
+
+    last_time = std::max(last_time, time_ms);  // keep the column sorted
+    static_cast<uint32_t*>(columns[USER].data)[row] = user_id;
+    static_cast<uint32_t*>(columns[TICKER].data)[row] = ticker_id;
+    static_cast<uint8_t*>(columns[SIDE].data)[row] = side;
+    static_cast<int32_t*>(columns[QUANTITY].data)[row] = quantity;
+    static_cast<double*>(columns[PRICE].data)[row] = price;
+    static_cast<int64_t*>(columns[TIME].data)[row] = last_time;
+    storeCount(row + 1);
+    return true;
+}
+
+void TradeStore::truncate(size_t rows) {
+    if (rows >= this->rows()) return;
+    storeCount(rows);
+    last_time = rows > 0 ? times()[rows - 1] : 0;
+}
+
+size_t TradeStore::lowerBound(int64_t time_ms) const {
+    const int64_t* begin = times();
+    return static_cast<size_t>(std::lower_bound(begin, begin + rows(), time_ms) - begin);
+}
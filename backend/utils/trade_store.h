@@ -0,0 +1,94 @@
+#ifndef TRADE_STORE_H
+#define TRADE_STORE_H
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+#include "dictionary.h"
+
+// Columnar, append-only store of executed trades (db/history/).
+//
+// Each field is its own file of fixed-width values, memory-mapped:
+//   user.u32 ticker.u32 side.u8 quantity.i32 price.f64 time.i64
+// Users and tickers are dictionary-encoded; users.dict and tickers.dict
+// hold one name per line and a name's id is its line number. `rows` holds
+// the committed row count.
+//
+// Each column is mapped once with room for MAX_ROWS, so its address never
+// changes; the files themselves grow in chunks as rows are appended. There
+// is one writer (the trade log's flusher, or loading at startup). Readers
+// load rows() and may then read any row below it without a lock; only the
+// dictionaries take a lock. Scans over a column are plain loops over
+// contiguous arrays, which the compiler vectorizes.
+//
+// The store is derived from transactions.csv and is not synced; the
+// TransactionIndex reconciles it with the CSV at startup.
+class TradeStore {
+public:
+    static const size_t MAX_ROWS = size_t(1) << 30;
+    enum Side : uint8_t { BUY = 0, SELL = 1 };
+
+    explicit TradeStore(const std::string& directory);
+    ~TradeStore();
+    TradeStore(const TradeStore&) = delete;
+    TradeStore& operator=(const TradeStore&) = delete;
+
+    // Map (creating if needed) the files; false if the directory is unusable
+    bool open();
+
+    size_t rows() const { return count.load(std::memory_order_acquire); }
+
+    // Append one row; single writer only. False if the store is full or
+    // could not grow.
+    bool append(std::string_view user, Side side, std::string_view ticker, int32_t quantity, double price,
+                int64_t time_ms);
+
+    // Drop rows from the end (startup only, before readers exist)
+    void truncate(size_t rows);
+
+    // Column arrays, valid for indexes below rows()
+    const uint32_t* users() const { return static_cast<const uint32_t*>(columns[USER].data); }
+    const uint32_t* tickers() const { return static_cast<const uint32_t*>(columns[TICKER].data); }
+    const uint8_t* sides() const { return static_cast<const uint8_t*>(columns[SIDE].data); }
+    const int32_t* quantities() const { return static_cast<const int32_t*>(columns[QUANTITY].data); }
+    const double* prices() const { return static_cast<const double*>(columns[PRICE].data); }
+    const int64_t* times() const { return static_cast<const int64_t*>(columns[TIME].data); }
+
+    // Dictionaries
+    std::optional<uint32_t> findUser(std::string_view name) const { return users_dict.find(name); }
+    std::optional<uint32_t> findTicker(std::string_view name) const { return tickers_dict.find(name); }
+    std::string userName(uint32_t id) const { return users_dict.name(id); }
+    std::string tickerName(uint32_t id) const { return tickers_dict.name(id); }
+    size_t userCount() const { return users_dict.size(); }
+    size_t tickerCount() const { return tickers_dict.size(); }
+
+    // First row with time >= time_ms (times never decrease along the store)
+    size_t lowerBound(int64_t time_ms) const;
+
+private:
+    enum Column { USER, TICKER, SIDE, QUANTITY, PRICE, TIME, COLUMN_COUNT };
+
+    struct MappedColumn {
+        int fd = -1;
+        size_t width = 0;
+        size_t capacity = 0;  // rows the file currently has room for
+        void* data = nullptr;
+    };
+
+    bool openColumn(Column column, const std::string& name, size_t width);
+    bool reserve(size_t rows);
+    void storeCount(size_t rows);
+
+    const std::string directory;
+    MappedColumn columns[COLUMN_COUNT];
+    int rows_fd = -1;
+    uint64_t* persisted_rows = nullptr;
+    std::atomic<size_t> count{0};
+    int64_t last_time = 0;
+    NameDictionary users_dict;
+    NameDictionary tickers_dict;
+};
+
+#endif
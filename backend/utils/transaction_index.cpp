@@ -0,0 +1,256 @@
+#include "transaction_index.h"
+#include "transaction_manager.h"
+#include "csv.h"
+#include "logger.h"
+#include <charconv>
+#include <chrono>
+#include <mutex>
+
+const std::string HISTORY_DIRECTORY = "db/history";
+
+namespace {
+
+// Prices are written to transactions.csv with six decimals (std::to_string)
+std::string formatPrice(double price) {
+    char text[64];
+    auto result = std::to_chars(text, text + sizeof(text), price, std::chars_format::fixed, 6);
+    return std::string(text, result.ptr);
+}
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct CsvTrade {
+    std::string user, side, ticker;
+    int quantity = 0;
+};
+
+}  // namespace
+
+TransactionIndex::TransactionIndex(const std::string& directory) : store(directory) {}
+
+void TransactionIndex::load(const std::string& filename) {
+    std::unique_lock<std::shared_mutex> lock(index_mutex);
+    if (!store.open()) {
+        LOG_ERROR("Cannot open trade store for " << filename << ": " << errno);
+        return;
+    }
+
+    // The store holds a prefix of the file unless it was lost or the file
+    // was replaced; check the last row the two should share
+    size_t stored = store.rows();
+    size_t in_file = 0;
+    CsvTrade at_stored, last;
+    visitCSV(filename, [&](const CsvRow& row) {
+        int quantity;
+        double price;
+        if (!row.get(3, quantity) || !row.get(4, price) || (row[1] != "BUY" && row[1] != "SELL")) return;
+        if (in_file + 1 == stored) at_stored = {std::string(row[0]), std::string(row[1]), std::string(row[2]), quantity};
+        last = {std::string(row[0]), std::string(row[1]), std::string(row[2]), quantity};
+        ++in_file;
+    });
+
+    size_t keep = std::min(stored, in_file);
+    if (keep > 0) {
+        const CsvTrade& expected = in_file >= stored ? at_stored : last;
+        size_t row = keep - 1;
+        bool same = store.userName(store.users()[row]) == expected.user &&
+                    store.tickerName(store.tickers()[row]) == expected.ticker &&
+                    store.quantities()[row] == expected.quantity &&
+                    (store.sides()[row] == TradeStore::SELL) == (expected.side == "SELL");
+        if (!same) {
+            LOG_WARN("Trade store does not match " << filename << ", rebuilding it");
+            keep = 0;
+        }
+    }
+    store.truncate(keep);
+
+    if (keep < in_file) {
+        size_t seen = 0;
+        visitCSV(filename, [&](const CsvRow& row) {
+            int quantity;
+            double price;
+            if (!row.get(3, quantity) || !row.get(4, price) || (row[1] != "BUY" && row[1] != "SELL")) return;
+            if (seen++ >= keep) store.append(row[0], row[1] == "SELL" ? TradeStore::SELL : TradeStore::BUY, row[2],
+                                             quantity, price, 0);
+        });
+    }
+
+    rows_by_user.assign(store.userCount(), {});
+    const uint32_t* users = store.users();
+    size_t rows = store.rows();
+    for (size_t row = 0; row < rows; ++row) {
+        rows_by_user[users[row]].push_back(static_cast<uint32_t>(row));
+    }
+}
+
+void TransactionIndex::add(const TradeRecord& record) {
+    double price = 0;
+    std::from_chars(record.price.data(), record.price.data() + record.price.size(), price);
+    TradeStore::Side side = record.side == "SELL" ? TradeStore::SELL : TradeStore::BUY;
+    if (!store.append(record.username, side, record.ticker, record.quantity, price, nowMs())) return;
+
+    size_t row = store.rows() - 1;
+    uint32_t user = store.users()[row];
+    {
+        std::unique_lock<std::shared_mutex> lock(index_mutex);
+        if (user >= rows_by_user.size()) rows_by_user.resize(user + 1);
+        rows_by_user[user].push_back(static_cast<uint32_t>(row));
+    }
+
+    std::lock_guard<std::mutex> lock(listeners_mutex);
+    for (const auto& listener : listeners) listener(record.ticker, store.times()[row], record.quantity, price);
+}
+
+void TransactionIndex::forEachTrade(int64_t from, const TradeVisitor& visit) const {
+    size_t end = store.rows();
+    const uint32_t* tickers = store.tickers();
+    const int32_t* quantities = store.quantities();
+    const double* prices = store.prices();
+    const int64_t* times = store.times();
+    std::vector<std::string> names;
+    for (size_t row = store.lowerBound(from); row < end; ++row) {
+        uint32_t ticker = tickers[row];
+        while (names.size() <= ticker) names.push_back(store.tickerName(static_cast<uint32_t>(names.size())));
+        visit(names[ticker], times[row], quantities[row], prices[row]);
+    }
+}
+
+void TransactionIndex::addListener(TradeVisitor listener) {
+    std::lock_guard<std::mutex> lock(listeners_mutex);
+    listeners.push_back(std::move(listener));
+}
+
+const std::vector<uint32_t>* TransactionIndex::rowsOf(const std::string& username) const {
+    auto user = store.findUser(username);
+    if (!user || *user >= rows_by_user.size()) return nullptr;
+    return &rows_by_user[*user];
+}
+
+std::vector<TransactionEntry> TransactionIndex::history(const std::string& username, const std::string& side,
+                                                        size_t offset, size_t limit, int64_t from, int64_t to) const {
+    std::vector<TransactionEntry> result;
+    int wanted = side.empty() ? -1 : side == "BUY" ? TradeStore::BUY : side == "SELL" ? TradeStore::SELL : -2;
+    if (wanted == -2) return result;
+
+    std::shared_lock<std::shared_mutex> lock(index_mutex);
+    const std::vector<uint32_t>* rows = rowsOf(username);
+    if (!rows) return result;
+
+    const uint8_t* sides = store.sides();
+    const int64_t* times = store.times();
+    size_t skipped = 0;
+    for (auto it = rows->rbegin(); it != rows->rend() && result.size() < limit; ++it) {
+        uint32_t row = *it;
+        if (times[row] > to) continue;
+        if (times[row] < from) break;  // a user's rows are in time order too
+        if (wanted >= 0 && sides[row] != wanted) continue;
+        if (skipped++ < offset) continue;
+
+        TransactionEntry entry;
+        entry.username = username;
+        entry.side = sides[row] == TradeStore::SELL ? "SELL" : "BUY";
+        entry.ticker = store.tickerName(store.tickers()[row]);
+        entry.quantity = store.quantities()[row];
+        entry.price = formatPrice(store.prices()[row]);
+        entry.time_ms = times[row];
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+std::vector<TickerPnl> TransactionIndex::pnl(const std::string& username, int64_t from, int64_t to) const {
+    std::vector<TickerPnl> result;
+    std::vector<uint32_t> slot_of_ticker;  // ticker id -> result index + 1
+
+    std::shared_lock<std::shared_mutex> lock(index_mutex);
+    const std::vector<uint32_t>* rows = rowsOf(username);
+    if (!rows) return result;
+
+    const uint32_t* tickers = store.tickers();
+    const uint8_t* sides = store.sides();
+    const int32_t* quantities = store.quantities();
+    const double* prices = store.prices();
+    const int64_t* times = store.times();
+    for (uint32_t row : *rows) {
+        if (times[row] < from) continue;
+        if (times[row] > to) break;
+        uint32_t ticker = tickers[row];
+        if (ticker >= slot_of_ticker.size()) slot_of_ticker.resize(ticker + 1, 0);
+        if (slot_of_ticker[ticker] == 0) {
+            result.push_back({store.tickerName(ticker)});
+            slot_of_ticker[ticker] = static_cast<uint32_t>(result.size());
+        }
+        TickerPnl& p = result[slot_of_ticker[ticker] - 1];
+
+        long long quantity = quantities[row];
+        double value = quantity * prices[row];
+        if (sides[row] == TradeStore::BUY) {
+            p.bought += quantity;
+            p.buy_value += value;
+            p.position += quantity;
+            p.cost_basis += value;
+        } else {
+            // Sells beyond what was bought in the range are valued at zero cost
+            double average = p.position > 0 ? p.cost_basis / p.position : 0;
+            long long matched = std::min(quantity, std::max(p.position, 0LL));
+            p.sold += quantity;
+            p.sell_value += value;
+            p.realized += value - average * matched;
+            p.cost_basis -= average * matched;
+            p.position -= quantity;
+        }
+    }
+    return result;
+}
+
+std::vector<TickerVolume> TransactionIndex::volume(int64_t from, int64_t to, const std::string& ticker) const {
+    std::vector<TickerVolume> result;
+    size_t begin = store.lowerBound(from);
+    size_t end = to == ALL_TIME ? store.rows() : store.lowerBound(to + 1);
+    if (begin > end) begin = end;
+
+    const uint32_t* tickers = store.tickers();
+    const int32_t* quantities = store.quantities();
+    const double* prices = store.prices();
+
+    if (!ticker.empty()) {
+        auto id = store.findTicker(ticker);
+        if (!id) return result;
+        // Branch-free so the loop vectorizes
+        const uint32_t wanted = *id;
+        long long trades = 0, quantity = 0;
+        double notional = 0;
+        for (size_t row = begin; row < end; ++row) {
+            long long match = tickers[row] == wanted;
+            trades += match;
+            quantity += match * quantities[row];
+            notional += static_cast<double>(match * quantities[row]) * prices[row];
+        }
+        result.push_back({ticker, trades, quantity, notional});
+        return result;
+    }
+
+    size_t ticker_count = store.tickerCount();  // read after rows(), so it covers every id below end
+    std::vector<long long> trades(ticker_count), quantity(ticker_count);
+    std::vector<double> notional(ticker_count);
+    for (size_t row = begin; row < end; ++row) {
+        uint32_t id = tickers[row];
+        trades[id] += 1;
+        quantity[id] += quantities[row];
+        notional[id] += quantities[row] * prices[row];
+    }
+    for (size_t id = 0; id < ticker_count; ++id) {
+        if (trades[id] > 0) {
+            result.push_back({store.tickerName(static_cast<uint32_t>(id)), trades[id], quantity[id], notional[id]});
+        }
+    }
+    return result;
+}
+
+TransactionIndex& transactionIndex() {
+    static TransactionIndex index(HISTORY_DIRECTORY);
+    return index;
+}
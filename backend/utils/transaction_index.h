@@ -0,0 +1,100 @@
+#ifndef TRANSACTION_INDEX_H
+#define TRANSACTION_INDEX_H
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include <limits>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include "trade_store.h"
+
+struct TradeRecord;
+
+// One row of transactions.csv
+struct TransactionEntry {
+    std::string username;
+    std::string side;    // "BUY" or "SELL"
+    std::string ticker;
+    int quantity = 0;
+    std::string price;   // as written to transactions.csv
+    int64_t time_ms = 0; // when it was recorded; 0 if it predates the store
+};
+
+// Realized result of one user's trades in one ticker (average cost)
+struct TickerPnl {
+    std::string ticker;
+    long long bought = 0;
+    long long sold = 0;
+    double buy_value = 0;
+    double sell_value = 0;
+    double realized = 0;     // sell proceeds minus the average cost of what was sold
+    long long position = 0;  // bought - sold within the range
+    double cost_basis = 0;   // average cost of that position
+};
+
+// Traded quantity and value of one ticker
+struct TickerVolume {
+    std::string ticker;
+    long long trades = 0;
+    long long quantity = 0;
+    double notional = 0;
+};
+
+// History and reporting over the trades in transactions.csv.
+//
+// Rows live in a columnar TradeStore (db/history/); the index keeps, per
+// user, the ids of that user's rows, so "the last n of one side" and paged
+// history cost time proportional to the rows returned. P&L walks one
+// user's rows; volume scans the ticker, quantity and price columns over
+// the row range of a time window. The trade log loads it after recovery
+// and adds every trade as it is appended to transactions.csv.
+//
+// Times are milliseconds since the epoch; [from, to] is inclusive.
+class TransactionIndex {
+public:
+    static const int64_t ALL_TIME = std::numeric_limits<int64_t>::max();
+
+    explicit TransactionIndex(const std::string& directory);
+
+    // Open the store and bring it in line with a transactions file: rows
+    // already stored keep their times, rows missing from the store are
+    // added from the file with time 0
+    void load(const std::string& filename);
+
+    void add(const TradeRecord& record);
+
+    // Rows of one user, newest first, skipping `offset` and returning at
+    // most `limit`. side is "BUY", "SELL" or "" for both.
+    std::vector<TransactionEntry> history(const std::string& username, const std::string& side,
+                                          size_t offset, size_t limit,
+                                          int64_t from = 0, int64_t to = ALL_TIME) const;
+
+    // Per-ticker realized P&L of one user, in first-traded order
+    std::vector<TickerPnl> pnl(const std::string& username, int64_t from = 0, int64_t to = ALL_TIME) const;
+
+    // Volume per ticker (or of one ticker if given), by ticker name
+    std::vector<TickerVolume> volume(int64_t from = 0, int64_t to = ALL_TIME, const std::string& ticker = "") const;
+
+    // Every stored trade with a time at or after from, oldest first
+    using TradeVisitor = std::function<void(const std::string& ticker, int64_t time_ms, int quantity, double price)>;
+    void forEachTrade(int64_t from, const TradeVisitor& visit) const;
+
+    // Called on the trade log's flusher thread for each trade added
+    void addListener(TradeVisitor listener);
+
+private:
+    const std::vector<uint32_t>* rowsOf(const std::string& username) const;
+
+    TradeStore store;
+    mutable std::shared_mutex index_mutex;        // guards rows_by_user
+    std::vector<std::vector<uint32_t>> rows_by_user;  // user id -> row ids, oldest first
+    std::mutex listeners_mutex;
+    std::vector<TradeVisitor> listeners;
+};
+
+// Process-wide index of db/transactions.csv (filled by the trade log)
+TransactionIndex& transactionIndex();
+
+#endif
@@ -0,0 +1,371 @@
+#include "transaction_manager.h"
+#include "csv.h"
+#include "snapshot.h"
+#include "metrics.h"
+#include "logger.h"
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+const std::string WAL_FILE = "db/trades.wal";
+const std::string HOLDINGS_FILE = "db/holdings.csv";
+const std::string TRANSACTIONS_FILE = "db/transactions.csv";
+
+// Fold the log into holdings.csv after this many trades or this much time
+const size_t CHECKPOINT_RECORDS = 10000;
+const auto CHECKPOINT_PERIOD = std::chrono::seconds(30);
+
+bool validTradeField(std::string_view text) {
+    return !text.empty() && text.find_first_of("|\r\n") == std::string_view::npos;
+}
+
+namespace {
+
+// Escape what would end a field or a line
+std::string escapeField(const std::string& field) {
+    if (field.find_first_of("%|\r\n") == std::string::npos) return field;
+    std::string out;
+    for (char c : field) {
+        if (c == '%' || c == '|' || c == '\r' || c == '\n') {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "%%%02X", static_cast<unsigned char>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string unescapeField(const std::string& field) {
+    if (field.find('%') == std::string::npos) return field;
+    std::string out;
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] == '%' && i + 2 < field.size() && std::isxdigit(static_cast<unsigned char>(field[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(field[i + 2]))) {
+            out += static_cast<char>(std::stoi(field.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += field[i];
+        }
+    }
+    return out;
+}
+
+// Append "|<crc>\n" to a line body
+std::string frame(const std::string& body) {
+    char crc[16];
+    std::snprintf(crc, sizeof(crc), "|%08x\n", crc32(body.data(), body.size()));
+    return body + crc;
+}
+
+// Split a framed line (without its newline) into fields, or return false
+// if the checksum is wrong
+bool unframe(const std::string& line, std::vector<std::string>& fields) {
+    size_t bar = line.rfind('|');
+    if (bar == std::string::npos || line.size() - bar != 9) return false;
+    char expected[9];
+    std::snprintf(expected, sizeof(expected), "%08x", crc32(line.data(), bar));
+    if (line.compare(bar + 1, 8, expected) != 0) return false;
+
+    fields.clear();
+    std::stringstream ss(line.substr(0, bar));
+    std::string field;
+    while (std::getline(ss, field, '|')) {
+        fields.push_back(unescapeField(field));
+    }
+    return true;
+}
+
+std::string recordLine(const TradeRecord& r) {
+    return frame(std::to_string(r.seq) + "|" + r.side + "|" + escapeField(r.username) + "|" +
+                 escapeField(r.ticker) + "|" + std::to_string(r.quantity) + "|" + r.price + "|" + std::to_string(r.position));
+}
+
+void transactionRow(CsvWriter& rows, const TradeRecord& r) {
+    rows.row(r.username, r.side, r.ticker, r.quantity, r.price);
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+off_t fileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+}  // namespace
+
+TransactionManager::TransactionManager(const std::string& wal_file,
+                                       const std::string& holdings_file,
+                                       const std::string& transactions_file,
+                                       HoldingsStore& holdings,
+                                       TransactionIndex& index)
+    : wal_file(wal_file), holdings_file(holdings_file),
+      transactions_file(transactions_file), holdings(holdings), index(index) {
+    recover();
+    flusher = std::thread([this] { flusherLoop(); });
+}
+
+TransactionManager::~TransactionManager() {
+    {
+        std::lock_guard<std::mutex> lock(wal_mutex);
+        stopping = true;
+    }
+    pending_cv.notify_one();
+    if (flusher.joinable()) flusher.join();
+    if (wal_fd >= 0) ::close(wal_fd);
+    if (transactions_fd >= 0) ::close(transactions_fd);
+}
+
+void TransactionManager::recover() {
+    std::ifstream wal(wal_file);
+    std::string line;
+    std::vector<std::string> fields;
+    CsvWriter replayed_rows;
+    size_t replayed = 0;
+
+    if (wal && std::getline(wal, line)) {
+        off_t base = -1;
+        if (unframe(line, fields) && fields.size() == 2 && fields[0] == "BASE") {
+            base = std::stoll(fields[1]);
+        } else {
+            LOG_WARN("Ignoring trade log with bad header: " << wal_file);
+        }
+
+        if (base >= 0) {
+            // Drop whatever part of the log already reached transactions.csv
+            off_t size = fileSize(transactions_file);
+            if (size > base && ::truncate(transactions_file.c_str(), base) != 0) {
+                LOG_ERROR("Failed to truncate " << transactions_file << ": " << errno);
+            }
+
+            size_t line_number = 1;
+            while (std::getline(wal, line)) {
+                ++line_number;
+                TradeRecord r;
+                bool valid = unframe(line, fields) && fields.size() == 7;
+                if (valid) {
+                    try {
+                        r.seq = std::stoull(fields[0]);
+                        r.quantity = std::stoi(fields[4]);
+                        r.position = std::stoi(fields[6]);
+                    } catch (const std::exception&) {
+                        valid = false;
+                    }
+                }
+                if (!valid) {
+                    if (wal.peek() == std::char_traits<char>::eof()) break;  // torn tail of the last write
+                    LOG_ERROR("Skipping corrupt record at line " << line_number << " of " << wal_file);
+                    continue;
+                }
+                r.side = fields[1];
+                r.username = fields[2];
+                r.ticker = fields[3];
+                r.price = fields[5];
+
+                holdings.setQuantity(r.username, r.ticker, r.position);
+                dirty_positions[{r.username, r.ticker}] = r.position;
+                transactionRow(replayed_rows, r);
+                next_seq = r.seq + 1;
+                ++replayed;
+            }
+        }
+    }
+    durable_seq = next_seq - 1;
+
+    transactions_fd = ::open(transactions_file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (transactions_fd < 0 || !writeAll(transactions_fd, replayed_rows.data())) {
+        LOG_ERROR("Failed to open " << transactions_file << ": " << errno);
+    }
+    index.load(transactions_file);
+    if (replayed > 0) {
+        LOG_INFO("Replayed " << replayed << " trades from " << wal_file);
+    }
+
+    // Start every run from a fresh log
+    checkpoint();
+}
+
+uint64_t TransactionManager::append(TradeRecord record) {
+    std::lock_guard<std::mutex> lock(wal_mutex);
+    record.seq = next_seq++;
+    pending_lines += recordLine(record);
+    pending.push_back(std::move(record));
+    pending_cv.notify_one();
+    return pending.back().seq;
+}
+
+uint64_t TransactionManager::append(std::vector<TradeRecord> records) {
+    if (records.empty()) return 0;
+    std::lock_guard<std::mutex> lock(wal_mutex);
+    for (auto& record : records) {
+        record.seq = next_seq++;
+        pending_lines += recordLine(record);
+        pending.push_back(std::move(record));
+    }
+    pending_cv.notify_one();
+    return pending.back().seq;
+}
+
+bool TransactionManager::waitDurable(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(wal_mutex);
+    durable_cv.wait(lock, [this, seq] { return durable_seq >= seq || failed; });
+    return durable_seq >= seq;
+}
+
+void TransactionManager::flusherLoop() {
+    std::vector<TradeRecord> batch;
+    std::string lines;
+    auto last_checkpoint = std::chrono::steady_clock::now();
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(wal_mutex);
+        pending_cv.wait_for(lock, CHECKPOINT_PERIOD, [this] {
+            return stopping || !pending.empty();
+        });
+
+        if (pending.empty()) {
+            bool done = stopping;
+            lock.unlock();
+            if (records_since_checkpoint > 0 &&
+                (done || std::chrono::steady_clock::now() - last_checkpoint >= CHECKPOINT_PERIOD)) {
+                checkpoint();
+                last_checkpoint = std::chrono::steady_clock::now();
+            }
+            if (done) return;
+            continue;
+        }
+
+        batch.swap(pending);
+        lines.swap(pending_lines);
+        uint64_t last_seq = batch.back().seq;
+        bool already_failed = failed;
+        lock.unlock();
+
+        bool ok = !already_failed && flush(batch, lines);
+
+        lock.lock();
+        if (ok) {
+            durable_seq = last_seq;
+        } else if (!failed) {
+            failed = true;
+            LOG_ERROR("Trade log write failed, rejecting further trades: " << errno);
+        }
+        lock.unlock();
+        durable_cv.notify_all();
+
+        batch.clear();
+        lines.clear();
+
+        if (ok && records_since_checkpoint >= CHECKPOINT_RECORDS) {
+            checkpoint();
+            last_checkpoint = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+// Write one batch to the log with a single fsync, then mirror it into
+// transactions.csv (which recovery can rebuild, so it is not synced here).
+bool TransactionManager::flush(std::vector<TradeRecord>& batch, std::string& lines) {
+    static const LatencyHistogram flush_duration("server_wal_flush_duration_seconds", "",
+                                                 "Time to write and fsync one group commit");
+    static const Counter records("server_wal_records_total", "", "Trades written to the log");
+    static const Counter flushes("server_wal_flushes_total", "", "Group commits (one fsync each)");
+    {
+        ScopedTimer timer(flush_duration);
+        if (!writeAll(wal_fd, lines) || ::fsync(wal_fd) != 0) {
+            return false;
+        }
+    }
+    records.add(batch.size());
+    flushes.add();
+
+    CsvWriter rows;
+    for (const auto& r : batch) {
+        transactionRow(rows, r);
+        dirty_positions[{r.username, r.ticker}] = r.position;
+        index.add(r);
+    }
+    records_since_checkpoint += batch.size();
+
+    if (!writeAll(transactions_fd, rows.data())) {
+        LOG_ERROR("Failed to append to " << transactions_file << ": " << errno);
+    }
+    return true;
+}
+
+// Fold the positions written since the last checkpoint into holdings.csv
+// and restart the log. Runs on the flusher thread (or during recovery).
+void TransactionManager::checkpoint() {
+    static const LatencyHistogram checkpoint_duration("server_wal_checkpoint_duration_seconds", "",
+                                                      "Time to fold the log into holdings.csv");
+    ScopedTimer timer(checkpoint_duration);
+    if (transactions_fd >= 0) ::fsync(transactions_fd);
+
+    if (!dirty_positions.empty()) {
+        // Rebuild from the previous snapshot rather than the live store,
+        // which may already contain trades that are not durable yet
+        std::vector<std::pair<std::string, std::string>> order;  // (user, ticker) in file order
+        std::map<std::pair<std::string, std::string>, std::string> quantities;
+        visitCSV(holdings_file, [&](const CsvRow& row) {
+            if (row.size() < 3) return;
+            auto key = std::make_pair(std::string(row[0]), std::string(row[1]));
+            auto it = quantities.find(key);
+            if (it != quantities.end()) {
+                it->second = row[2];
+            } else {
+                order.push_back(key);
+                quantities.emplace(std::move(key), row[2]);
+            }
+        });
+        for (const auto& position : dirty_positions) {
+            auto inserted = quantities.insert_or_assign(position.first, std::to_string(position.second));
+            if (inserted.second) order.push_back(position.first);
+        }
+
+        CsvWriter snapshot;
+        for (const auto& key : order) {
+            snapshot.row(key.first, key.second, quantities[key]);
+        }
+        if (!snapshot.writeTo(holdings_file)) {
+            LOG_ERROR("Checkpoint of " << holdings_file << " failed: " << errno);
+            if (wal_fd < 0) wal_fd = ::open(wal_file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+            return;  // keep the current log; it still covers everything
+        }
+    }
+
+    off_t base = fileSize(transactions_file);
+    if (!replaceFile(wal_file, frame("BASE|" + std::to_string(base < 0 ? 0 : base)))) {
+        LOG_ERROR("Failed to restart trade log " << wal_file << ": " << errno);
+        if (wal_fd < 0) wal_fd = ::open(wal_file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        return;
+    }
+
+    if (wal_fd >= 0) ::close(wal_fd);
+    wal_fd = ::open(wal_file.c_str(), O_WRONLY | O_APPEND);
+    dirty_positions.clear();
+    records_since_checkpoint = 0;
+}
+
+TransactionManager& transactionManager() {
+    static TransactionManager manager(WAL_FILE, HOLDINGS_FILE, TRANSACTIONS_FILE,
+                                      holdingsStore(), transactionIndex());
+    return manager;
+}
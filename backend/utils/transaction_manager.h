@@ -0,0 +1,113 @@
+#ifndef TRANSACTION_MANAGER_H
+#define TRANSACTION_MANAGER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "holdings_store.h"
+#include "transaction_index.h"
+
+struct TradeRecord {
+    uint64_t seq = 0;
+    std::string username;
+    std::string side;      // "BUY" or "SELL"
+    std::string ticker;
+    int quantity = 0;
+    std::string price;     // formatted as written to transactions.csv
+    int position = 0;      // holding of (username, ticker) after the trade
+};
+
+// True if text may be a username or ticker of a trade: not empty and free
+// of line breaks and '|', which separate records and fields downstream
+bool validTradeField(std::string_view text);
+
+// Write-ahead log for trades (db/trades.wal).
+//
+// Each trade is one text line "seq|side|user|ticker|qty|price|position|crc".
+// '%', '|', '\r' and '\n' inside a field are written as %XX escapes, so a
+// field can never split a record. A record that fails its checksum is a
+// torn write if it is the last line; anywhere else it is logged as
+// corruption and skipped.
+// A background flusher writes every pending line with a single write() and
+// fsync(), so concurrent trades share one disk flush (group commit), then
+// appends the same trades to transactions.csv. Every CHECKPOINT_RECORDS
+// trades (or CHECKPOINT_PERIOD) the log is folded into holdings.csv and
+// restarted.
+//
+// The first line of the log records the size of transactions.csv when the
+// log was started. Recovery truncates transactions.csv back to that size
+// and re-appends the logged trades; holdings are restored by reapplying the
+// absolute positions, which is idempotent on top of any snapshot. The
+// TransactionIndex is loaded once recovery has rebuilt transactions.csv and
+// then receives each trade as it is flushed.
+class TransactionManager {
+public:
+    TransactionManager(const std::string& wal_file,
+                       const std::string& holdings_file,
+                       const std::string& transactions_file,
+                       HoldingsStore& holdings,
+                       TransactionIndex& index);
+    ~TransactionManager();
+
+    // Queue a trade that has already been applied to the holdings store.
+    // Call while holding the lock that ordered the trade; returns its seq.
+    uint64_t append(TradeRecord record);
+
+    // Queue several trades at once, so the same flush writes them all;
+    // returns the seq of the last one (0 if records is empty)
+    uint64_t append(std::vector<TradeRecord> records);
+
+    // Block until the trade with this seq is on disk. False if the log
+    // could not be written.
+    bool waitDurable(uint64_t seq);
+
+    // False once a write or fsync of the log has failed; from then on
+    // nothing more is written and trades must be refused before they touch
+    // the holdings. Trades already applied when the failure hit stay in
+    // memory (their callers are told they failed) but never reach the
+    // disk, so a restart drops them.
+    bool healthy() const { return !failed.load(std::memory_order_acquire); }
+
+private:
+    void recover();
+    void flusherLoop();
+    bool flush(std::vector<TradeRecord>& batch, std::string& lines);
+    void checkpoint();
+
+    const std::string wal_file;
+    const std::string holdings_file;
+    const std::string transactions_file;
+    HoldingsStore& holdings;
+    TransactionIndex& index;
+
+    int wal_fd = -1;
+    int transactions_fd = -1;
+
+    std::mutex wal_mutex;
+    std::condition_variable pending_cv;
+    std::condition_variable durable_cv;
+    std::vector<TradeRecord> pending;
+    std::string pending_lines;
+    uint64_t next_seq = 1;
+    uint64_t durable_seq = 0;
+    std::atomic<bool> failed{false};  // written under wal_mutex
+    bool stopping = false;
+
+    // Touched only by the flusher thread (and recovery before it starts)
+    std::map<std::pair<std::string, std::string>, int> dirty_positions;
+    size_t records_since_checkpoint = 0;
+
+    std::thread flusher;
+};
+
+// Process-wide log for db/ (replays db/trades.wal on first use)
+TransactionManager& transactionManager();
+
+#endif
@@ -0,0 +1,95 @@
+#include "user_directory.h"
+#include "csv.h"
+#include "metrics.h"
+#include <vector>
+
+const std::string USERS_FILE = "db/users.csv";
+
+namespace {
+
+std::string_view stripLineEnd(std::string_view s) {
+    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+    return s;
+}
+
+}  // namespace
+
+UserDirectory::UserDirectory(const std::string& filename) : filename(filename) {
+    std::vector<std::pair<std::string, std::string>> loaded;
+    std::array<size_t, SHARDS> counts{};
+    visitCSV(filename, [&](const CsvRow& row) {
+        if (row.size() < 2) return;
+        std::string username(stripLineEnd(row[0]));
+        ++counts[std::hash<std::string>{}(username) % SHARDS];
+        loaded.emplace_back(std::move(username), stripLineEnd(row[1]));
+    });
+
+    for (size_t i = 0; i < SHARDS; ++i) {
+        size_t buckets = MIN_BUCKETS;
+        while (buckets < counts[i] * 2) buckets *= 2;
+        shards[i].heads.reset(new std::atomic<const Account*>[buckets]);
+        for (size_t b = 0; b < buckets; ++b) shards[i].heads[b].store(nullptr, std::memory_order_relaxed);
+        shards[i].mask = buckets - 1;
+    }
+    for (const auto& [username, password] : loaded) {
+        if (!find(username)) insert(username, password);  // first registration wins
+    }
+}
+
+UserDirectory::~UserDirectory() {
+    for (Shard& shard : shards) {
+        for (size_t b = 0; b <= shard.mask; ++b) {
+            const Account* account = shard.heads[b].load(std::memory_order_relaxed);
+            while (account) {
+                const Account* next = account->next;
+                delete account;
+                account = next;
+            }
+        }
+    }
+}
+
+std::atomic<const UserDirectory::Account*>& UserDirectory::bucketFor(const std::string& username) const {
+    size_t hash = std::hash<std::string>{}(username);
+    const Shard& shard = shards[hash % SHARDS];
+    return shard.heads[(hash / SHARDS) & shard.mask];
+}
+
+const UserDirectory::Account* UserDirectory::find(const std::string& username) const {
+    for (const Account* account = bucketFor(username).load(std::memory_order_acquire); account;
+         account = account->next) {
+        if (account->username == username) return account;
+    }
+    return nullptr;
+}
+
+// Inserters are serialized (register_mutex, or the constructor), so the
+// head cannot move between the load and the store
+void UserDirectory::insert(const std::string& username, const std::string& password) {
+    std::atomic<const Account*>& head = bucketFor(username);
+    head.store(new Account{username, password, head.load(std::memory_order_relaxed)}, std::memory_order_release);
+}
+
+bool UserDirectory::authenticate(const std::string& username, const std::string& password) const {
+    const Account* account = find(username);
+    return account && account->password == password;
+}
+
+bool UserDirectory::exists(const std::string& username) const {
+    return find(username) != nullptr;
+}
+
+bool UserDirectory::add(const std::string& username, const std::string& password) {
+    static const LatencyHistogram wait("server_lock_wait_seconds", "lock=\"registration\"", "");
+    auto lock = lockTimed(register_mutex, wait);
+    if (find(username)) return false;
+
+    appendCSV(filename, {username, password});
+    insert(username, password);
+    return true;
+}
+
+UserDirectory& userDirectory() {
+    static UserDirectory directory(USERS_FILE);
+    return directory;
+}
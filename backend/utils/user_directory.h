@@ -0,0 +1,58 @@
+#ifndef USER_DIRECTORY_H
+#define USER_DIRECTORY_H
+
+#include <string>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Resident copy of users.csv.
+//
+// Accounts are spread over SHARDS insert-only hash tables by username.
+// Each bucket is a chain of immutable accounts behind an atomic head
+// pointer, so logins are lock-free reads that never touch the disk.
+// users.csv is only ever appended to: registration writes the new row,
+// then pushes one account onto its bucket's chain. Accounts are never
+// removed, so readers need no reclamation. The bucket count is fixed when
+// the file is loaded (at least twice the users then), so only accounts
+// registered since startup lengthen the chains.
+class UserDirectory {
+public:
+    explicit UserDirectory(const std::string& filename);
+    ~UserDirectory();
+    UserDirectory(const UserDirectory&) = delete;
+    UserDirectory& operator=(const UserDirectory&) = delete;
+
+    bool authenticate(const std::string& username, const std::string& password) const;
+    bool exists(const std::string& username) const;
+
+    // Record a new account; false if the name is taken
+    bool add(const std::string& username, const std::string& password);
+
+private:
+    struct Account {
+        std::string username;
+        std::string password;
+        const Account* next;
+    };
+    struct Shard {
+        std::unique_ptr<std::atomic<const Account*>[]> heads;
+        size_t mask = 0;  // bucket count - 1
+    };
+    static const size_t SHARDS = 16;
+    static const size_t MIN_BUCKETS = 1024;  // per shard
+
+    std::atomic<const Account*>& bucketFor(const std::string& username) const;
+    const Account* find(const std::string& username) const;
+    void insert(const std::string& username, const std::string& password);
+
+    const std::string filename;
+    std::array<Shard, SHARDS> shards;
+    std::mutex register_mutex;  // one inserter at a time; orders appends to the file
+};
+
+// Process-wide directory backed by db/users.csv
+UserDirectory& userDirectory();
+
+#endif
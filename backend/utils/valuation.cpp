@@ -0,0 +1,142 @@
+#include "valuation.h"
+#include "metrics.h"
+#include <utility>
+
+ValuationEngine::ValuationEngine(HoldingsStore& holdings, QuoteTable& quotes, TransactionIndex& history)
+    : shards(SHARDS) {
+    {
+        auto market = quotes.snapshot();
+        for (const auto& quote : market->quotes) prices[quote.ticker] = quote.price;
+    }
+
+    std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> positions;
+    holdings.forEachPosition([&positions](const std::string& username, const std::string& ticker, int quantity) {
+        positions[username].emplace_back(ticker, quantity);
+    });
+
+    for (const auto& account : positions) {
+        std::unordered_map<std::string, double> average_cost;
+        for (const auto& pnl : history.pnl(account.first)) {
+            if (pnl.position > 0) average_cost[pnl.ticker] = pnl.cost_basis / pnl.position;
+        }
+
+        auto& valued = shardFor(account.first).accounts[account.first];
+        for (const auto& position : account.second) {
+            PositionValue& p = valued[position.first];
+            p.ticker = position.first;
+            p.quantity = position.second;
+            p.price = priceOf(p.ticker);
+            p.value = p.quantity * p.price;
+            auto cost = average_cost.find(p.ticker);
+            p.cost_basis = p.quantity * (cost != average_cost.end() ? cost->second : p.price);
+            if (p.quantity != 0) holders[p.ticker].insert(account.first);
+        }
+    }
+
+    quotes.addListener([this](const MarketSnapshot& previous, const MarketSnapshot& next) {
+        onPrices(previous, next);
+    });
+}
+
+ValuationEngine::Shard& ValuationEngine::shardFor(const std::string& username) {
+    return shards[std::hash<std::string>{}(username) % SHARDS];
+}
+
+const ValuationEngine::Shard& ValuationEngine::shardFor(const std::string& username) const {
+    return shards[std::hash<std::string>{}(username) % SHARDS];
+}
+
+double ValuationEngine::priceOf(const std::string& ticker) const {
+    std::shared_lock<std::shared_mutex> lock(prices_mutex);
+    auto it = prices.find(ticker);
+    return it == prices.end() ? 0.0 : it->second;
+}
+
+void ValuationEngine::setPrice(const std::string& ticker, double price) {
+    std::unique_lock<std::shared_mutex> lock(prices_mutex);
+    prices[ticker] = price;
+}
+
+void ValuationEngine::addHolder(const std::string& ticker, const std::string& username) {
+    std::unique_lock<std::shared_mutex> lock(holders_mutex);
+    holders[ticker].insert(username);
+}
+
+void ValuationEngine::removeHolder(const std::string& ticker, const std::string& username) {
+    std::unique_lock<std::shared_mutex> lock(holders_mutex);
+    auto it = holders.find(ticker);
+    if (it == holders.end()) return;
+    it->second.erase(username);
+    if (it->second.empty()) holders.erase(it);
+}
+
+void ValuationEngine::onTrade(const std::string& username, const std::string& ticker, bool buy, int traded,
+                              double price, int quantity) {
+    Shard& shard = shardFor(username);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    PositionValue& p = shard.accounts[username][ticker];
+    p.ticker = ticker;
+
+    // Join the reverse index before reading the price (see the class comment)
+    if (p.quantity == 0 && quantity != 0) addHolder(ticker, username);
+
+    if (buy) {
+        p.cost_basis += traded * price;
+    } else if (p.quantity > 0) {
+        p.cost_basis -= p.cost_basis / p.quantity * traded;
+    }
+    p.quantity = quantity;
+    if (p.quantity == 0) {
+        p.cost_basis = 0;
+        removeHolder(ticker, username);
+    }
+    p.price = priceOf(ticker);
+    p.value = p.quantity * p.price;
+}
+
+void ValuationEngine::onPrices(const MarketSnapshot& previous, const MarketSnapshot& next) {
+    static const Counter remarked("server_valuation_remarks_total", "",
+                                  "Positions re-marked because their ticker's price changed");
+    forEachChangedQuote(next, [&](const Quote& quote) {
+        const Quote* before = previous.find(quote.ticker);
+        if (before && before->price == quote.price) return;
+        setPrice(quote.ticker, quote.price);
+
+        std::vector<std::string> users;
+        {
+            std::shared_lock<std::shared_mutex> lock(holders_mutex);
+            auto it = holders.find(quote.ticker);
+            if (it == holders.end()) return;
+            users.assign(it->second.begin(), it->second.end());
+        }
+        for (const auto& username : users) {
+            Shard& shard = shardFor(username);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto account = shard.accounts.find(username);
+            if (account == shard.accounts.end()) continue;
+            auto position = account->second.find(quote.ticker);
+            if (position == account->second.end()) continue;
+            PositionValue& p = position->second;
+            p.price = quote.price;
+            p.value = p.quantity * p.price;
+        }
+        remarked.add(users.size());
+    });
+}
+
+std::vector<PositionValue> ValuationEngine::portfolio(const std::string& username) const {
+    std::vector<PositionValue> result;
+    const Shard& shard = shardFor(username);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto account = shard.accounts.find(username);
+    if (account != shard.accounts.end()) {
+        result.reserve(account->second.size());
+        for (const auto& position : account->second) result.push_back(position.second);
+    }
+    return result;
+}
+
+ValuationEngine& valuationEngine() {
+    static ValuationEngine engine(holdingsStore(), quoteTable(), transactionIndex());
+    return engine;
+}
@@ -0,0 +1,79 @@
+#ifndef VALUATION_H
+#define VALUATION_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <shared_mutex>
+#include <mutex>
+#include "holdings_store.h"
+#include "quote_table.h"
+#include "transaction_index.h"
+
+// One valued position
+struct PositionValue {
+    std::string ticker;
+    int quantity = 0;
+    double price = 0;       // last price the position was marked at
+    double value = 0;       // quantity * price
+    double cost_basis = 0;  // average cost of the shares held
+    double unrealized() const { return value - cost_basis; }
+};
+
+// Marked-to-market portfolios, kept current incrementally.
+//
+// Every account's positions carry their value and average-cost basis. A
+// trade updates the one position it touches; a price change walks a
+// ticker -> holders reverse index and re-marks only the accounts that hold
+// that ticker. PORTFOLIO is then a copy of one account's positions.
+//
+// Positions are sharded by username like HoldingsStore. Values are always
+// recomputed as quantity * current price (never adjusted by a delta), and
+// a trade joins the reverse index before it reads the price, so a trade
+// racing a price change cannot leave a position marked at the old price.
+//
+// At startup quantities come from the holdings store and the cost basis
+// from each account's trade history (average cost); a position the history
+// does not explain is costed at the current price.
+class ValuationEngine {
+public:
+    ValuationEngine(HoldingsStore& holdings, QuoteTable& quotes, TransactionIndex& history);
+
+    // Record a trade already applied to the holdings store; quantity is
+    // the position after the trade. Call under the account's trade lock.
+    void onTrade(const std::string& username, const std::string& ticker, bool buy, int traded, double price,
+                 int quantity);
+
+    // Positions of one user ordered by ticker, as in the holdings store
+    std::vector<PositionValue> portfolio(const std::string& username) const;
+
+private:
+    void onPrices(const MarketSnapshot& previous, const MarketSnapshot& next);
+    double priceOf(const std::string& ticker) const;
+    void setPrice(const std::string& ticker, double price);
+    void addHolder(const std::string& ticker, const std::string& username);
+    void removeHolder(const std::string& ticker, const std::string& username);
+
+    static const size_t SHARDS = 64;
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::map<std::string, PositionValue>> accounts;
+    };
+    Shard& shardFor(const std::string& username);
+    const Shard& shardFor(const std::string& username) const;
+
+    std::vector<Shard> shards;
+
+    mutable std::shared_mutex prices_mutex;
+    std::unordered_map<std::string, double> prices;
+
+    mutable std::shared_mutex holders_mutex;
+    std::unordered_map<std::string, std::unordered_set<std::string>> holders;  // ticker -> users with quantity != 0
+};
+
+// Process-wide engine over holdingsStore(), quoteTable() and transactionIndex()
+ValuationEngine& valuationEngine();
+
+#endif
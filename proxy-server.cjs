@@ -1,5 +1,5 @@
 const express = require('express');
-const net = require('net');
+const http = require('http');
 const cors = require('cors');
 const bodyParser = require('body-parser');
 
@@ -8,6 +8,9 @@ const PORT = 3001;
 const BACKEND_HOST = 'localhost';
 const BACKEND_PORT = 8080;
 
+// Reuse backend connections instead of opening one per command
+const backendAgent = new http.Agent({ keepAlive: true, maxSockets: 64 });
+
 // Enable CORS and body parsing
 app.use(cors());
 app.use(bodyParser.text()); // Parse text/plain requests
@@ -18,52 +21,43 @@ app.post('/', async (req, res) => {
     const command = req.body;
     console.log(`Received command: ${command}`);
     
-    // Function to create a socket and send command
+    // Send the command over a pooled keep-alive connection
     const sendToBackend = () => {
       return new Promise((resolve, reject) => {
-        // Create a socket client
-        const client = new net.Socket();
-        let responseData = '';
-        
-        // Set a timeout
-        const timeout = setTimeout(() => {
-          client.destroy();
-          reject(new Error('Connection timeout'));
-        }, 5000);
-        
-        // Connect to backend
-        client.connect(BACKEND_PORT, BACKEND_HOST, () => {
-          console.log('Connected to backend server');
-          
-          // With HTTP headers
-          const httpCommand = `GET /${command} HTTP/1.1\r\nHost: localhost\r\n\r\n`;
-          client.write(httpCommand);
-        });
-        
-        // Handle data received
-        client.on('data', (data) => {
-          responseData += data.toString();
-          // Close the connection after receiving data
-          client.end();
+        const backendReq = http.request({
+          host: BACKEND_HOST,
+          port: BACKEND_PORT,
+          method: 'POST',
+          path: '/',
+          agent: backendAgent,
+          timeout: 5000,
+          headers: {
+            'Content-Type': 'text/plain',
+            'Content-Length': Buffer.byteLength(command),
+          },
+        }, (backendRes) => {
+          let responseData = '';
+          backendRes.setEncoding('utf8');
+          backendRes.on('data', (chunk) => {
+            responseData += chunk;
+          });
+          backendRes.on('end', () => {
+            resolve(responseData.trim());
+          });
         });
-        
-        // Handle connection closed
-        client.on('close', () => {
-          clearTimeout(timeout);
-          console.log('Connection closed');
-          console.log(`Raw response: ${JSON.stringify(responseData)}`);
-          
-          // Parse HTTP response - extract the body
-          const responseBody = responseData.split('\r\n\r\n')[1] || responseData;
-          resolve(responseBody.trim());
+
+        // Handle timeout
+        backendReq.on('timeout', () => {
+          backendReq.destroy(new Error('Connection timeout'));
         });
-        
+
         // Handle errors
-        client.on('error', (err) => {
-          clearTimeout(timeout);
-          console.error('Socket error:', err);
+        backendReq.on('error', (err) => {
+          console.error('Backend request error:', err);
           reject(err);
         });
+
+        backendReq.end(command);
       });
     };
     
@@ -4,7 +4,7 @@ import Layout from '@/components/layout/Layout';
 import { Card, CardContent, CardDescription, CardHeader, CardTitle } from '@/components/ui/card';
 import { Wallet } from 'lucide-react';
 import { Tabs, TabsContent, TabsList, TabsTrigger } from '@/components/ui/tabs';
-import { getMarketData, getPortfolio, buyStock, sellStock, getRecentTransactions, getRecentSells } from '@/services/socketService';
+import { subscribeMarketData, getDashboardData, buyStock, sellStock } from '@/services/socketService';
 import { Button } from '@/components/ui/button';
 import { Dialog, DialogContent, DialogDescription, DialogFooter, DialogHeader, DialogTitle, DialogTrigger } from '@/components/ui/dialog';
 import { Input } from '@/components/ui/input';
@@ -51,63 +51,38 @@ const Dashboard = () => {
 
     setUser(userObj);
 
-    const fetchRecentTransactions = async () => {
-      const result = await getRecentTransactions(username);
-      if (result.success && result.data) {
-        setRecentTransactions(result.data);
-      }
-    };
-
-    const fetchRecentSells = async () => {
-      const result = await getRecentSells(username);
-      if (result.success && result.data) {
-        setRecentSells(result.data);
-      }
-    };
-
-    // Fetch market data
-    const fetchMarketData = async () => {
-      try {
-        setIsLoadingMarketData(true);
-        const result = await getMarketData();
-        if (result.success && result.stocks) {
-          setMarketData(result.stocks);
-        } else {
-          console.error('Failed to fetch market data:', result.message);
-        }
-      } catch (error) {
-        console.error('Error fetching market data:', error);
-      } finally {
-        setIsLoadingMarketData(false);
-      }
-    };
+    // Market data arrives as a snapshot on connect, then as pushed changes
+    setIsLoadingMarketData(true);
+    const unsubscribeMarket = subscribeMarketData((stocks) => {
+      setMarketData(stocks);
+      setIsLoadingMarketData(false);
+    });
 
-    // Fetch portfolio data
-    const fetchPortfolioData = async () => {
+    // Portfolio and recent trades arrive together in one BATCH request
+    const fetchAccountData = async () => {
       try {
         setIsLoadingPortfolio(true);
-        const result = await getPortfolio(username);
-        if (result.success && result.holdings) {
-          setPortfolioData(result.holdings);
+        const { portfolio, buys, sells } = await getDashboardData(username);
+        if (portfolio.success && portfolio.holdings) {
+          setPortfolioData(portfolio.holdings);
         } else {
-          console.error('Failed to fetch portfolio:', result.message);
+          console.error('Failed to fetch portfolio:', portfolio.message);
         }
+        if (buys.success && buys.data) setRecentTransactions(buys.data);
+        if (sells.success && sells.data) setRecentSells(sells.data);
       } catch (error) {
-        console.error('Error fetching portfolio:', error);
+        console.error('Error fetching account data:', error);
       } finally {
         setIsLoadingPortfolio(false);
       }
     };
 
-    // Call both fetch functions
-    fetchMarketData();
-    fetchPortfolioData();
-    fetchRecentTransactions();
-    fetchRecentSells();
-
+    fetchAccountData();
 
     // Complete loading
     setLoading(false);
+
+    return unsubscribeMarket;
   }, [navigate]);
 
   // Function to refresh data after a purchase
@@ -116,15 +91,12 @@ const Dashboard = () => {
     if (!username) return;
   
     try {
-      const [marketRes, portfolioRes, transactionsRes] = await Promise.all([
-        getMarketData(),
-        getPortfolio(username),
-        getRecentTransactions(username)
-      ]);
+      // Prices are kept current by the market stream
+      const { portfolio, buys, sells } = await getDashboardData(username);
   
-      if (marketRes.success) setMarketData(marketRes.stocks);
-      if (portfolioRes.success) setPortfolioData(portfolioRes.holdings);
-      if (transactionsRes.success) setRecentTransactions(transactionsRes.data);
+      if (portfolio.success) setPortfolioData(portfolio.holdings);
+      if (buys.success) setRecentTransactions(buys.data);
+      if (sells.success) setRecentSells(sells.data);
     } catch (error) {
       console.error("Error refreshing data:", error);
     }
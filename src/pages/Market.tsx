@@ -6,7 +6,7 @@ import { AreaChart, Area, XAxis, YAxis, CartesianGrid, Tooltip, ResponsiveContai
 import { ArrowDown, ArrowUp, Search, SlidersHorizontal } from 'lucide-react';
 import { Input } from '@/components/ui/input';
 import { Button } from '@/components/ui/button';
-import { getMarketData } from '@/services/socketService';
+import { getMarketData, subscribeMarketData } from '@/services/socketService';
 
 const Market = () => {
   const [user, setUser] = useState(null);
@@ -101,6 +101,12 @@ const Market = () => {
     };
 
     fetchMarketData();
+
+    // Keep prices current as the server pushes changes
+    const unsubscribe = subscribeMarketData((liveStocks) => {
+      if (liveStocks.length > 0) setStocks(liveStocks);
+    });
+    return unsubscribe;
   }, [navigate]);
 
   const filteredStocks = stocks.filter(stock => 
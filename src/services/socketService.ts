@@ -40,6 +40,19 @@ export const sendCommand = async (command: string): Promise<string> => {
   }
 };
 
+/**
+ * Sends several commands in one BATCH request
+ * @param commands Pipe commands (not LOGIN); BUY and SELL are applied together
+ * @returns Promise that resolves with each command's response, in order
+ */
+export const sendBatch = async (commands: string[]): Promise<string[]> => {
+  const response = await sendCommand(`BATCH\n${commands.join('\n')}`);
+  if (!response.startsWith('[')) {
+    throw new Error(parseResponse(response).message);
+  }
+  return JSON.parse(response);
+};
+
 /**
  * Parses a response from the server - handles both formatted protocol responses and direct JSON
  */
@@ -212,112 +225,167 @@ export const getMarketData = async (): Promise<{ success: boolean, stocks?: Arra
   }
 };
 
+/**
+ * Subscribes to live market prices pushed by the server (Server-Sent Events)
+ * @param onUpdate Called with the full stock list on connect and after every price change
+ * @returns Function that closes the subscription
+ */
+export const subscribeMarketData = (
+  onUpdate: (stocks: Array<{ ticker: string, name: string, price: number }>) => void
+): (() => void) => {
+  const source = new EventSource(`http://${SERVER_URL}:${SERVER_PORT}/STREAM_MARKET`, { withCredentials: true });
+  const stocks = new Map<string, { ticker: string, name: string, price: number }>();
+
+  // Event data uses the GET_MARKET format: DATA|ticker,name,price;...
+  const applyRows = (data: string) => {
+    data.substring(5).split(';').filter(item => item.trim() !== '').forEach(stockItem => {
+      const [ticker, name, price] = stockItem.split(',');
+      stocks.set(ticker, { ticker, name, price: parseFloat(price) });
+    });
+  };
+
+  source.addEventListener('snapshot', (event) => {
+    stocks.clear();
+    applyRows((event as MessageEvent).data);
+    onUpdate(Array.from(stocks.values()));
+  });
+  source.addEventListener('delta', (event) => {
+    applyRows((event as MessageEvent).data);
+    onUpdate(Array.from(stocks.values()));
+  });
+  source.addEventListener('remove', (event) => {
+    (event as MessageEvent).data.split(',').forEach((ticker: string) => stocks.delete(ticker));
+    onUpdate(Array.from(stocks.values()));
+  });
+  source.onerror = () => {
+    // EventSource reconnects on its own and receives a fresh snapshot
+    console.warn('Market stream interrupted, reconnecting');
+  };
+
+  return () => source.close();
+};
+
 /**
  * Get user portfolio
  * @param username The username to get portfolio for
  * @returns Promise resolving to portfolio data
  */
-export const getPortfolio = async (username: string): Promise<{ success: boolean, holdings?: Array<{ ticker: string, quantity: number }>, message: string }> => {
+export interface Holding {
+  ticker: string;
+  quantity: number;
+  value?: number;          // marked at the server's current price
+  costBasis?: number;      // average cost of the shares held
+  unrealizedPnl?: number;
+}
+
+export const getPortfolio = async (username: string): Promise<{ success: boolean, holdings?: Holding[], message: string }> => {
   try {
     console.log(`Fetching portfolio for ${username}`);
-    const response = await sendCommand(`PORTFOLIO|${username}`);
-    console.log('Raw portfolio response:', response);
-    
-    // First try to parse as direct JSON
-    try {
-      if (response.startsWith('[') || response.startsWith('{')) {
-        const jsonResponse = JSON.parse(response);
-        
-        // If it's an array, assume it's the holdings directly
-        if (Array.isArray(jsonResponse)) {
-          return {
-            success: true,
-            holdings: jsonResponse,
-            message: 'Portfolio retrieved successfully'
-          };
-        }
-        
-        // If it has a holdings property, use that
-        if (jsonResponse.holdings) {
-          return {
-            success: true,
-            holdings: jsonResponse.holdings,
-            message: 'Portfolio retrieved successfully'
-          };
-        }
+    return parsePortfolio(await sendCommand(`PORTFOLIO|${username}`));
+  } catch (error) {
+    console.error('Error in getPortfolio:', error);
+    return {
+      success: false,
+      holdings: [], // Provide an empty array to prevent errors
+      message: error instanceof Error ? error.message : 'Failed to get portfolio'
+    };
+  }
+};
+
+// Reads a PORTFOLIO response (also used for batched requests)
+const parsePortfolio = (response: string): { success: boolean, holdings?: Holding[], message: string } => {
+  console.log('Raw portfolio response:', response);
+  
+  // First try to parse as direct JSON
+  try {
+    if (response.startsWith('[') || response.startsWith('{')) {
+      const jsonResponse = JSON.parse(response);
+      
+      // If it's an array, assume it's the holdings directly
+      if (Array.isArray(jsonResponse)) {
+        return {
+          success: true,
+          holdings: jsonResponse,
+          message: 'Portfolio retrieved successfully'
+        };
+      }
+      
+      // If it has a holdings property, use that
+      if (jsonResponse.holdings) {
+        return {
+          success: true,
+          holdings: jsonResponse.holdings,
+          message: 'Portfolio retrieved successfully'
+        };
       }
-    } catch (e) {
-      console.log('Not direct JSON, trying standard parsing');
     }
-    
-    const result = parseResponse(response);
-    console.log('Parsed portfolio response:', result);
-    
-    // Check if we have structured data from parseResponse
-    if (result.status === 'OK' && result.data) {
-      // If data is already an object/array from JSON parsing
-      if (typeof result.data === 'object') {
-        // Direct array
-        if (Array.isArray(result.data)) {
-          return {
-            success: true,
-            holdings: result.data,
-            message: 'Portfolio retrieved successfully'
-          };
-        }
-        // Object with holdings property
-        else if (result.data.holdings) {
-          return {
-            success: true,
-            holdings: result.data.holdings,
-            message: 'Portfolio retrieved successfully'
-          };
-        }
+  } catch (e) {
+    console.log('Not direct JSON, trying standard parsing');
+  }
+  
+  const result = parseResponse(response);
+  console.log('Parsed portfolio response:', result);
+  
+  // Check if we have structured data from parseResponse
+  if (result.status === 'OK' && result.data) {
+    // If data is already an object/array from JSON parsing
+    if (typeof result.data === 'object') {
+      // Direct array
+      if (Array.isArray(result.data)) {
+        return {
+          success: true,
+          holdings: result.data,
+          message: 'Portfolio retrieved successfully'
+        };
       }
-      
-      // Otherwise assume it's a string format
-      if (typeof result.data === 'string') {
-        // This section needs to be updated to handle the specific format
-        // DATA|AAPL,4;GOOGL,1;
-        const holdingsString = result.data;
-        const holdings = [];
-        
-        // Split by semicolon to get each holding
-        const holdingPairs = holdingsString.split(';').filter(item => item.trim() !== '');
-        
-        for (const pair of holdingPairs) {
-          // Split by comma to get ticker and quantity
-          const [ticker, quantityStr] = pair.split(',');
-          if (ticker && quantityStr) {
-            holdings.push({
-              ticker,
-              quantity: parseInt(quantityStr, 10)
-            });
-          }
-        }
-        
+      // Object with holdings property
+      else if (result.data.holdings) {
         return {
           success: true,
-          holdings,
+          holdings: result.data.holdings,
           message: 'Portfolio retrieved successfully'
         };
       }
     }
     
-    // If we get here, something went wrong with parsing
-    return {
-      success: false,
-      holdings: [], // Provide an empty array to prevent errors
-      message: result.message || 'Failed to parse portfolio data'
-    };
-  } catch (error) {
-    console.error('Error in getPortfolio:', error);
-    return {
-      success: false,
-      holdings: [], // Provide an empty array to prevent errors
-      message: error instanceof Error ? error.message : 'Failed to get portfolio'
-    };
+    // Otherwise assume it's a string format
+    if (typeof result.data === 'string') {
+      // DATA|ticker,quantity,value,costBasis,unrealizedPnl;...
+      const holdingsString = result.data;
+      const holdings: Holding[] = [];
+      
+      // Split by semicolon to get each holding
+      const holdingPairs = holdingsString.split(';').filter(item => item.trim() !== '');
+      
+      for (const pair of holdingPairs) {
+        const [ticker, quantityStr, valueStr, costStr, pnlStr] = pair.split(',');
+        if (ticker && quantityStr) {
+          holdings.push({
+            ticker,
+            quantity: parseInt(quantityStr, 10),
+            ...(valueStr !== undefined && {
+              value: parseFloat(valueStr),
+              costBasis: parseFloat(costStr),
+              unrealizedPnl: parseFloat(pnlStr)
+            })
+          });
+        }
+      }
+      
+      return {
+        success: true,
+        holdings,
+        message: 'Portfolio retrieved successfully'
+      };
+    }
   }
+  
+  // If we get here, something went wrong with parsing
+  return {
+    success: false,
+    holdings: [], // Provide an empty array to prevent errors
+    message: result.message || 'Failed to parse portfolio data'
+  };
 };
 
 /**
@@ -375,53 +443,7 @@ export const sellStock = async (username: string, ticker: string, quantity: numb
  */
 export const getRecentTransactions = async (username: string): Promise<{ success: boolean, data?: any[], message?: string }> => {
   try {
-    const response = await sendCommand(`CSV_BUYS|${username}`);
-    
-    // First try direct JSON parsing
-    try {
-      if (response.startsWith('[')) {
-        const jsonData = JSON.parse(response);
-        return { 
-          success: true, 
-          data: jsonData 
-        };
-      }
-    } catch (e) {
-      console.log('Transaction response is not direct JSON, trying standard parsing');
-    }
-    
-    // Fall back to response parsing
-    const result = parseResponse(response);
-    
-    if (result.status === 'OK' && result.data) {
-      // Already parsed as JSON in parseResponse
-      if (Array.isArray(result.data)) {
-        return { 
-          success: true, 
-          data: result.data 
-        };
-      }
-      
-      // Try to parse as JSON if it's a string
-      if (typeof result.data === 'string') {
-        try {
-          const jsonData = JSON.parse(result.data);
-          return { 
-            success: true, 
-            data: jsonData 
-          };
-        } catch (e) {
-          console.error("Error parsing transaction data as JSON:", e);
-        }
-      }
-    }
-    
-    // If we get here, we failed to parse properly
-    return { 
-      success: false, 
-      data: [],
-      message: result.message || 'Failed to parse transaction data' 
-    };
+    return parseTransactions(await sendCommand(`CSV_BUYS|${username}`));
   } catch (error) {
     console.error("Error fetching recent transactions:", error);
     return { 
@@ -432,60 +454,64 @@ export const getRecentTransactions = async (username: string): Promise<{ success
   }
 };
 
-/**
- * Get recent sell transactions
- * @param username The username to get sell history for
- * @returns Promise resolving to sell transaction data
- */
-export const getRecentSells = async (username: string): Promise<{ success: boolean, data?: any[], message?: string }> => {
+// Reads a CSV_BUYS or RECENT_SELLS response (also used for batched requests)
+const parseTransactions = (response: string): { success: boolean, data?: any[], message?: string } => {
+  
+  // First try direct JSON parsing
   try {
-    const response = await sendCommand(`RECENT_SELLS|${username}`);
-    
-    // First try direct JSON parsing
-    try {
-      if (response.startsWith('[')) {
-        const jsonData = JSON.parse(response);
-        return { 
-          success: true, 
-          data: jsonData 
-        };
-      }
-    } catch (e) {
-      console.log('Sell response is not direct JSON, trying standard parsing');
+    if (response.startsWith('[')) {
+      const jsonData = JSON.parse(response);
+      return { 
+        success: true, 
+        data: jsonData 
+      };
+    }
+  } catch (e) {
+    console.log('Transaction response is not direct JSON, trying standard parsing');
+  }
+  
+  // Fall back to response parsing
+  const result = parseResponse(response);
+  
+  if (result.status === 'OK' && result.data) {
+    // Already parsed as JSON in parseResponse
+    if (Array.isArray(result.data)) {
+      return { 
+        success: true, 
+        data: result.data 
+      };
     }
     
-    // Fall back to response parsing
-    const result = parseResponse(response);
-    
-    if (result.status === 'OK' && result.data) {
-      // Already parsed as JSON in parseResponse
-      if (Array.isArray(result.data)) {
+    // Try to parse as JSON if it's a string
+    if (typeof result.data === 'string') {
+      try {
+        const jsonData = JSON.parse(result.data);
         return { 
           success: true, 
-          data: result.data 
+          data: jsonData 
         };
-      }
-      
-      // Try to parse as JSON if it's a string
-      if (typeof result.data === 'string') {
-        try {
-          const jsonData = JSON.parse(result.data);
-          return { 
-            success: true, 
-            data: jsonData 
-          };
-        } catch (e) {
-          console.error("Error parsing sell data as JSON:", e);
-        }
+      } catch (e) {
+        console.error("Error parsing transaction data as JSON:", e);
       }
     }
-    
-    // If we get here, we failed to parse properly
-    return { 
-      success: false, 
-      data: [],
-      message: result.message || 'Failed to parse sell data' 
-    };
+  }
+  
+  // If we get here, we failed to parse properly
+  return { 
+    success: false, 
+    data: [],
+    message: result.message || 'Failed to parse transaction data' 
+  };
+};
+
+/**
+ * Get recent sell transactions
+ * @param username The username to get sell history for
+ * @returns Promise resolving to sell transaction data
+ */
+export const getRecentSells = async (username: string): Promise<{ success: boolean, data?: any[], message?: string }> => {
+  try {
+    return parseTransactions(await sendCommand(`RECENT_SELLS|${username}`));
   } catch (error) {
     console.error("Error fetching recent sells:", error);
     return { 
@@ -494,4 +520,22 @@ export const getRecentSells = async (username: string): Promise<{ success: boole
       message: error instanceof Error ? error.message : 'Network error' 
     };
   }
-};
\ No newline at end of file
+};
+
+/**
+ * Get everything the dashboard shows for a user in one round trip
+ * @param username The logged-in user
+ * @returns Promise resolving to the portfolio, recent buys and recent sells
+ */
+export const getDashboardData = async (username: string) => {
+  const [portfolio, buys, sells] = await sendBatch([
+    `PORTFOLIO|${username}`,
+    `CSV_BUYS|${username}`,
+    `RECENT_SELLS|${username}`
+  ]);
+  return {
+    portfolio: parsePortfolio(portfolio),
+    buys: parseTransactions(buys),
+    sells: parseTransactions(sells)
+  };
+};